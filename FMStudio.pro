@@ -1,2 +1,7 @@
 TEMPLATE = subdirs
-SUBDIRS =  src
+SUBDIRS =  src cli
+
+#The benchmarks and the golden-output test are opt-in: qmake CONFIG+=bench CONFIG+=tests
+#(the test target then runs with make check)
+bench: SUBDIRS += bench
+tests: SUBDIRS += tests
@@ -0,0 +1,336 @@
+/**********************************************************************************
+ * MIT License                                                                    *
+ *                                                                                *
+ * Copyright (c) 2023 Justin (tuxinator2009) Davis                                *
+ *                                                                                *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy   *
+ * of this software and associated documentation files (the "Software"), to deal  *
+ * in the Software without restriction, including without limitation the rights   *
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+ * copies of the Software, and to permit persons to whom the Software is          *
+ * furnished to do so, subject to the following conditions:                       *
+ *                                                                                *
+ * The above copyright notice and this permission notice shall be included in all *
+ * copies or substantial portions of the Software.                                *
+ *                                                                                *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+ * SOFTWARE.                                                                      *
+ **********************************************************************************/
+
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include "FMSynth/CompiledPatch.h"
+#include "FMSynth/Decimator.h"
+#include "FMSynth/EnvelopeGenerator.h"
+#include "FMSynth/Patch.h"
+#include "FMSynth/PhaseGenerator.h"
+#include "FMSynth/SineTable.h"
+#include "FMSynth/Voice.h"
+#include "FMSynth/VoiceBank.h"
+#include "FMSource.h"
+
+//Self-contained microbenchmarks for the synth core. Every benchmark is calibrated to run for at least
+//MIN_TIME seconds, then timed RUNS more times and the fastest run is reported so results are stable
+//enough to compare before/after a change on the same machine.
+//Usage: fmstudio-bench [filter], only benchmarks whose name contains filter are run.
+
+static constexpr double MIN_TIME = 0.1;
+static constexpr int RUNS = 5;
+static volatile int32_t sink;
+static const char *filter = nullptr;
+
+static void bench(const char *name, const char *unit, uint64_t itemsPerCall, std::function<void()> func)
+{
+  using Clock = std::chrono::steady_clock;
+  uint64_t calls = 1;
+  double best = 0.0;
+  if (filter != nullptr && strstr(name, filter) == nullptr)
+    return;
+  func();
+  for (;;)
+  {
+    Clock::time_point start = Clock::now();
+    for (uint64_t i = 0; i < calls; ++i)
+      func();
+    if (std::chrono::duration<double>(Clock::now() - start).count() >= MIN_TIME)
+      break;
+    calls *= 2;
+  }
+  for (int run = 0; run < RUNS; ++run)
+  {
+    Clock::time_point start = Clock::now();
+    for (uint64_t i = 0; i < calls; ++i)
+      func();
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    if (run == 0 || elapsed < best)
+      best = elapsed;
+  }
+  double items = (double)calls * itemsPerCall;
+  printf("%-32s %12.2f ns/%-7s %12.3f M%ss/s\n", name, best * 1e9 / items, unit, items / best / 1e6, unit);
+}
+
+//Same formula as Voice::_sin, which is private
+static constexpr int32_t quadraticSine(int32_t phase_Q15)
+{
+  int32_t p = phase_Q15 & 16383;
+  return (phase_Q15 & 16384 ? (p - 16384) : (16384 - p)) * p / 2048;
+}
+
+//Prints the max error over all phases relative to full scale, plus the level of the largest
+//harmonic relative to the fundamental (computed with a DFT of one cycle)
+static void sineAccuracy(const char *name, int32_t (*sine)(int32_t))
+{
+  constexpr int PHASES = 32768;
+  double maxError = 0.0;
+  double harmonics[16] = {};
+  if (filter != nullptr && strstr(name, filter) == nullptr)
+    return;
+  for (int phase = 0; phase < PHASES; ++phase)
+  {
+    double value = sine(phase);
+    double error = fabs(value - 32768.0 * sin(2.0 * M_PI * phase / PHASES));
+    if (error > maxError)
+      maxError = error;
+  }
+  for (int h = 1; h < 16; ++h)
+  {
+    double re = 0.0;
+    double im = 0.0;
+    for (int phase = 0; phase < PHASES; ++phase)
+    {
+      double value = sine(phase);
+      re += value * cos(2.0 * M_PI * h * phase / PHASES);
+      im += value * sin(2.0 * M_PI * h * phase / PHASES);
+    }
+    harmonics[h] = sqrt(re * re + im * im);
+  }
+  double worst = 0.0;
+  for (int h = 2; h < 16; ++h)
+    if (harmonics[h] > worst)
+      worst = harmonics[h];
+  printf("%-32s max error %.4f %%, largest harmonic %.1f dB\n", name, maxError * 100.0 / 32768.0, 20.0 * log10(worst / harmonics[1]));
+}
+
+//A patch that holds its sustain forever so voices never go idle while being measured
+static FMSynth::Patch makePatch(int algorithm)
+{
+  FMSynth::Patch patch;
+  memset(&patch, 0, sizeof(patch));
+  strcpy(patch.name, "BENCH");
+  patch.algorithm = algorithm;
+  patch.volume = 80;
+  patch.feedback = 60;
+  patch.decay = 50;
+  patch.sustain = 80;
+  patch.release = 30;
+  patch.lfo.speed = 40;
+  patch.lfo.attack = 20;
+  patch.lfo.pmd = 10;
+  for (int i = 0; i < 4; ++i)
+  {
+    patch.op[i].level = 100 - i * 10;
+    patch.op[i].pitch.coarse = i;
+    patch.op[i].pitch.fine = 50;
+    patch.op[i].detune = 50 + i;
+    patch.op[i].decay = 40;
+    patch.op[i].sustain = 70;
+  }
+  return patch;
+}
+
+int main(int argc, char *argv[])
+{
+  constexpr int SAMPLES = 4096;
+  static int16_t block[SAMPLES];
+  char name[64];
+  if (argc > 1)
+    filter = argv[1];
+  for (int algorithm = 1; algorithm <= 11; ++algorithm)
+  {
+    FMSynth::Patch patch = makePatch(algorithm);
+    FMSynth::Voice<8000> voice;
+    voice.noteOn(patch, 60, 127);
+    snprintf(name, sizeof(name), "Voice::update/algorithm<%d>", algorithm - 1);
+    bench(name, "sample", SAMPLES, [&voice]() {
+      int32_t sum = 0;
+      for (int i = 0; i < SAMPLES; ++i)
+        sum += voice.update();
+      sink = sum;
+    });
+  }
+  for (bool table : {false, true})
+  {
+    for (int algorithm = 1; algorithm <= 11; ++algorithm)
+    {
+      FMSynth::Patch patch = makePatch(algorithm);
+      FMSynth::Voice<8000> voice;
+      voice.setSineTable(table);
+      voice.noteOn(patch, 60, 127);
+      snprintf(name, sizeof(name), "Voice::render/algorithm<%d>%s", algorithm - 1, table ? "/table" : "");
+      bench(name, "sample", SAMPLES, [&voice]() {
+        voice.render(block, SAMPLES);
+        sink = block[SAMPLES - 1];
+      });
+    }
+  }
+  for (bool bandlimited : {false, true})
+  {
+    //Square and saw carriers with square modulators at 48000 Hz, where band-limiting is meant to be used
+    FMSynth::Patch patch = makePatch(5);
+    for (int i = 0; i < 4; ++i)
+      patch.op[i].waveform = (i % 2 == 0) ? FMSynth::Patch::Operator::Saw : FMSynth::Patch::Operator::Square;
+    FMSynth::Voice<48000> voice;
+    voice.setBandlimited(bandlimited);
+    voice.noteOn(patch, 60, 127);
+    bench(bandlimited ? "Voice::render/waveforms/bandlimited" : "Voice::render/waveforms", "sample", SAMPLES, [&voice]() {
+      voice.render(block, SAMPLES);
+      sink = block[SAMPLES - 1];
+    });
+  }
+  for (int numVoices : {1, 2, 4, 8, 16})
+  {
+    //A channel's voices mixed onto the 32-bit bus one at a time and by SIMD banks of 8 lanes as FMSource does
+    static FMSynth::Voice<8000> voices[16];
+    static FMSynth::VoiceBank<8000, 8> banks[2];
+    static int32_t bus[SAMPLES];
+    for (int i = 0; i < 16; ++i)
+    {
+      voices[i].reset();
+      banks[i / 8].reset(i % 8);
+    }
+    for (int i = 0; i < numVoices; ++i)
+    {
+      FMSynth::Patch patch = makePatch(1 + i % 11);
+      voices[i].noteOn(patch, 36 + i, 127);
+      banks[i / 8].noteOn(i % 8, patch, 36 + i, 127);
+    }
+    snprintf(name, sizeof(name), "Voice::render/mix/%d voices", numVoices);
+    bench(name, "sample", SAMPLES, [numVoices]() {
+      memset(bus, 0, sizeof(bus));
+      for (int i = 0; i < numVoices; ++i)
+      {
+        voices[i].render(block, SAMPLES);
+        for (int j = 0; j < SAMPLES; ++j)
+          bus[j] += block[j];
+      }
+      sink = bus[SAMPLES - 1];
+    });
+    snprintf(name, sizeof(name), "VoiceBank::renderAdd/%d voices", numVoices);
+    bench(name, "sample", SAMPLES, [numVoices]() {
+      memset(bus, 0, sizeof(bus));
+      for (int i = 0; i < (numVoices + 7) / 8; ++i)
+        banks[i].renderAdd(bus, SAMPLES);
+      sink = bus[SAMPLES - 1];
+    });
+  }
+  sineAccuracy("Sine/quadratic", quadraticSine);
+  sineAccuracy("Sine/table", FMSynth::sineTable);
+  {
+    //Phase increments vary per sample like a modulated operator so the table is not walked linearly
+    bench("Sine/quadratic", "sample", SAMPLES, []() {
+      int32_t sum = 0;
+      int32_t phase = 0;
+      for (int i = 0; i < SAMPLES; ++i)
+      {
+        int32_t out = quadraticSine(phase);
+        sum += out;
+        phase += 1237 + (out >> 4);
+      }
+      sink = sum;
+    });
+    bench("Sine/table", "sample", SAMPLES, []() {
+      int32_t sum = 0;
+      int32_t phase = 0;
+      for (int i = 0; i < SAMPLES; ++i)
+      {
+        int32_t out = FMSynth::sineTable(phase);
+        sum += out;
+        phase += 1237 + (out >> 4);
+      }
+      sink = sum;
+    });
+  }
+  {
+    FMSynth::EnvelopeGenerator env;
+    env.setAttackRate(FixedPoint::Fixed<FMSynth::EnvelopeGenerator::RATE_Q>(0.001));
+    env.setDecayRate(FixedPoint::Fixed<FMSynth::EnvelopeGenerator::RATE_Q>(0.0005));
+    env.setSustain(FixedPoint::Fixed<FMSynth::EnvelopeGenerator::LVL_Q>(0.5));
+    env.setLoop(0, 2);
+    env.trigger();
+    bench("EnvelopeGenerator::tick", "tick", SAMPLES, [&env]() {
+      int32_t sum = 0;
+      for (int i = 0; i < SAMPLES; ++i)
+        sum += env.tick();
+      sink = sum;
+    });
+  }
+  {
+    FMSynth::PhaseGenerator phase;
+    phase.setRate(0x01234567);
+    bench("PhaseGenerator::tick(pm)", "tick", SAMPLES, [&phase]() {
+      int32_t out = 0;
+      for (int i = 0; i < SAMPLES; ++i)
+        out = phase.tick(out >> 2);
+      sink = out;
+    });
+  }
+  {
+    constexpr int NOTES = 256;
+    FMSynth::Patch patches[11];
+    FMSynth::Voice<8000> voice;
+    for (int i = 0; i < 11; ++i)
+      patches[i] = makePatch(i + 1);
+    bench("Voice::noteOn", "call", NOTES, [&voice, &patches]() {
+      for (int i = 0; i < NOTES; ++i)
+        voice.noteOn(patches[i % 11], 24 + i % 72, 127);
+      sink = voice.midikey();
+    });
+    //Same notes from patches compiled up front, as songs start them
+    static FMSynth::CompiledPatch<8000> compiled[11];
+    for (int i = 0; i < 11; ++i)
+      compiled[i] = FMSynth::CompiledPatch<8000>::compile(patches[i]);
+    bench("Voice::noteOn/compiled", "call", NOTES, [&voice]() {
+      for (int i = 0; i < NOTES; ++i)
+        voice.noteOn(compiled[i % 11], 24 + i % 72, 127);
+      sink = voice.midikey();
+    });
+  }
+  for (unsigned factor : {2, 4})
+  {
+    //Oversampled bus of one export block, timed per output sample
+    static int32_t bus[SAMPLES * 4];
+    static int32_t out[SAMPLES];
+    FMSynth::Decimator decimator(factor);
+    for (unsigned i = 0; i < SAMPLES * factor; ++i)
+      bus[i] = (int32_t)(20000 * sin(i * 0.05)) + (int32_t)(i * 7919 % 4001) - 2000;
+    snprintf(name, sizeof(name), "Decimator::process/%ux", factor);
+    bench(name, "sample", SAMPLES, [&decimator, factor]() {
+      decimator.process(bus, SAMPLES * factor, out);
+      sink = out[SAMPLES - 1];
+    });
+  }
+  for (int numVoices : {1, 4, 16, 64})
+  {
+    FMSynth::Patch patch = makePatch(9);
+    FMSource source(1, 8000, FMSource::SampleFormat::UInt8, 64);
+    char data[512];
+    source.setTempo(120);
+    for (int i = 0; i < numVoices; ++i)
+      source.noteOn(0, patch, 36 + i, 1 << 20);
+    snprintf(name, sizeof(name), "FMSource::readData/%d voices", numVoices);
+    bench(name, "sample", sizeof(data), [&source, &data]() {
+      source.read(data, sizeof(data));
+      sink = data[0];
+    });
+  }
+  return 0;
+}
@@ -0,0 +1,43 @@
+TEMPLATE = app
+TARGET = fmstudio-cli
+DESTDIR = ..
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS FMSTUDIO_CLI
+
+LIBS+=-lm
+
+QT = core
+
+CONFIG += release
+
+INCLUDEPATH += ../src
+
+SOURCES += \
+        ../src/CHeaderParser/cheaderarray.cpp \
+        ../src/CHeaderParser/cheaderobject.cpp \
+        ../src/CHeaderParser/cheaderparser.cpp \
+        ../src/CHeaderParser/cheadervalue.cpp \
+        ../src/fmproject.cpp \
+        ../src/fmsong.cpp \
+        ../src/FMSource.cpp \
+        ../src/globals.cpp \
+        ../src/songrenderer.cpp \
+        ../src/undo.cpp \
+        ../src/wavwriter.cpp \
+        main.cpp
+
+HEADERS += \
+        ../src/CHeaderParser/cheaderarray.h \
+        ../src/CHeaderParser/cheaderobject.h \
+        ../src/CHeaderParser/cheaderparser.h \
+        ../src/CHeaderParser/cheadervalue.h \
+        ../src/fmproject.h \
+        ../src/fmsong.h \
+        ../src/FMSource.h \
+        ../src/globals.h \
+        ../src/songrenderer.h \
+        ../src/undo.h \
+        ../src/wavwriter.h
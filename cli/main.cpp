@@ -0,0 +1,179 @@
+/**********************************************************************************
+ * MIT License                                                                    *
+ *                                                                                *
+ * Copyright (c) 2023 Justin (tuxinator2009) Davis                                *
+ *                                                                                *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy   *
+ * of this software and associated documentation files (the "Software"), to deal  *
+ * in the Software without restriction, including without limitation the rights   *
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+ * copies of the Software, and to permit persons to whom the Software is          *
+ * furnished to do so, subject to the following conditions:                       *
+ *                                                                                *
+ * The above copyright notice and this permission notice shall be included in all *
+ * copies or substantial portions of the Software.                                *
+ *                                                                                *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+ * SOFTWARE.                                                                      *
+ **********************************************************************************/
+
+#include <cstdio>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFileInfo>
+#include <QList>
+#include <QStringList>
+#include "fmproject.h"
+#include "fmsong.h"
+#include "songrenderer.h"
+
+struct Export
+{
+  FMProject *project;
+  FMSong *song;
+  QString location;
+};
+
+int main(int argc, char *argv[])
+{
+  QCoreApplication a(argc, argv);
+  QCoreApplication::setApplicationName("fmstudio-cli");
+  QCommandLineParser parser;
+  QCommandLineOption formatOption(QStringList() << "f" << "format", "Output format: raw, wav or header (default: raw).", "format", "raw");
+  QCommandLineOption outputOption(QStringList() << "o" << "output", "Directory to export to, each project gets its own sub-directory (default: next to the project file).", "dir");
+  QCommandLineOption jobsOption(QStringList() << "j" << "jobs", "Number of songs/channels rendered in parallel (default: number of cores).", "N", "0");
+  QCommandLineOption songOption(QStringList() << "s" << "song", "Only export songs with this name, can be given more than once.", "name");
+  QCommandLineOption rateOption(QStringList() << "r" << "rate", "Sample rate of raw/wav output and --bake instruments: 8000, 16000, 22050, 44100 or 48000 (default: 8000).", "Hz", "8000");
+  QCommandLineOption typeOption(QStringList() << "t" << "type", "Sample type of raw/wav output: u8, s16 or f32 (default: u8).", "type", "u8");
+  QCommandLineOption oversampleOption(QStringList() << "x" << "oversample", "Render raw/wav output at 2x or 4x the sample rate and decimate, reduces aliasing at low rates (default: 1).", "factor", "1");
+  QCommandLineOption bandlimitedOption(QStringList() << "b" << "bandlimited", "Band-limited square and saw operators, reduces aliasing at high sample rates.");
+  QCommandLineOption bakeOption(QStringList() << "k" << "bake", "Header output also gets its instruments compiled for the --rate sample rate.");
+  QList<FMProject*> projects;
+  QList<Export> exports;
+  QString format;
+  QString extension;
+  FMSource::SampleFormat sampleFormat;
+  unsigned samplerate;
+  unsigned oversampling;
+  int result = 0;
+  parser.setApplicationDescription("Exports the songs of FM Studio projects without starting the editor.");
+  parser.addHelpOption();
+  parser.addOption(formatOption);
+  parser.addOption(outputOption);
+  parser.addOption(jobsOption);
+  parser.addOption(songOption);
+  parser.addOption(rateOption);
+  parser.addOption(typeOption);
+  parser.addOption(oversampleOption);
+  parser.addOption(bandlimitedOption);
+  parser.addOption(bakeOption);
+  parser.addPositionalArgument("projects", "FM Studio projects (*.fmx) to export.", "project.fmx...");
+  parser.process(a);
+  format = parser.value(formatOption);
+  if (format == "raw")
+    extension = ".raw";
+  else if (format == "wav")
+    extension = ".wav";
+  else if (format == "header")
+    extension = ".h";
+  else
+  {
+    fprintf(stderr, "Unknown format: %s\n", format.toLocal8Bit().data());
+    return 1;
+  }
+  samplerate = parser.value(rateOption).toUInt();
+  if (!FMSource::isSupportedSamplerate(samplerate))
+  {
+    fprintf(stderr, "Unsupported sample rate: %s\n", parser.value(rateOption).toLocal8Bit().data());
+    return 1;
+  }
+  oversampling = parser.value(oversampleOption).toUInt();
+  if (!SongRenderer::isSupportedOversampling(samplerate, oversampling))
+  {
+    fprintf(stderr, "Unsupported oversampling at %u Hz: %s\n", samplerate, parser.value(oversampleOption).toLocal8Bit().data());
+    return 1;
+  }
+  if (parser.value(typeOption) == "u8")
+    sampleFormat = FMSource::SampleFormat::UInt8;
+  else if (parser.value(typeOption) == "s16")
+    sampleFormat = FMSource::SampleFormat::Int16;
+  else if (parser.value(typeOption) == "f32")
+    sampleFormat = FMSource::SampleFormat::Float;
+  else
+  {
+    fprintf(stderr, "Unknown sample type: %s\n", parser.value(typeOption).toLocal8Bit().data());
+    return 1;
+  }
+  if (parser.positionalArguments().size() == 0)
+    parser.showHelp(1);
+  for (auto location : parser.positionalArguments())
+  {
+    FMProject *project = new FMProject(location);
+    QFileInfo info(location);
+    QDir dir((parser.isSet(outputOption)) ? parser.value(outputOption):info.absolutePath());
+    if (!project->isSaved())
+    {
+      delete project;
+      result = 1;
+      continue;
+    }
+    projects += project;
+    dir.mkpath(project->getName());
+    dir.cd(project->getName());
+    for (int i = 0; i < project->numSongs(); ++i)
+    {
+      FMSong *song = project->getSong(i);
+      if (parser.isSet(songOption) && !parser.values(songOption).contains(song->getName()))
+        continue;
+      exports += Export{project, song, dir.filePath(song->getName() + extension)};
+    }
+  }
+  if (format == "header")
+  {
+    for (auto &e : exports)
+    {
+      QString error;
+      if (!e.song->exportSong(e.location, parser.isSet(bakeOption) ? samplerate:0, &error))
+      {
+        fprintf(stderr, "Failed to export %s to %s\nReason: %s\n", e.song->getName().toLocal8Bit().data(), e.location.toLocal8Bit().data(), error.toLocal8Bit().data());
+        result = 1;
+        continue;
+      }
+      printf("%s\n", e.location.toLocal8Bit().data());
+    }
+  }
+  else
+  {
+    QList<FMSong*> songs;
+    QStringList locations;
+    QStringList errors;
+    for (auto &e : exports)
+    {
+      songs += e.song;
+      locations += e.location;
+    }
+    SongRenderer renderer(parser.value(jobsOption).toInt(), samplerate, sampleFormat);
+    renderer.setBandlimited(parser.isSet(bandlimitedOption));
+    renderer.setOversampling(oversampling);
+    errors = renderer.exportSongs(songs, locations, (format == "wav") ? WavWriter::Container::Wav:WavWriter::Container::Raw);
+    for (int i = 0; i < exports.size(); ++i)
+    {
+      if (!errors[i].isEmpty())
+      {
+        fprintf(stderr, "Failed to export %s to %s\nReason: %s\n", exports[i].song->getName().toLocal8Bit().data(), exports[i].location.toLocal8Bit().data(), errors[i].toLocal8Bit().data());
+        result = 1;
+        continue;
+      }
+      printf("%s\n", exports[i].location.toLocal8Bit().data());
+    }
+  }
+  for (auto project : projects)
+    delete project;
+  return result;
+}
@@ -1,15 +1,15 @@
 #pragma once
 
-const FMSynth::Patch patch_sweep =
+constexpr FMSynth::Patch patch_sweep =
 {
   .name="SWEEP", 
   .algorithm=4, .volume=80, .feedback=77, .glide=0, .attack=0, .decay=0, .sustain=100, .release=50, 
   .lfo={.speed=0, .attack=0, .pmd=0}, 
   .op=
   {
-    {.level=100, .pitch={.fixed=false, .coarse=1, .fine=0}, .detune=50, .attack=0, .decay=38, .sustain=0, .loop=true}, 
-    {.level=70, .pitch={.fixed=false, .coarse=1, .fine=0}, .detune=50, .attack=65, .decay=65, .sustain=0, .loop=true}, 
-    {.level=0, .pitch={.fixed=false, .coarse=1, .fine=0}, .detune=50, .attack=0, .decay=0, .sustain=100, .loop=false}, 
-    {.level=80, .pitch={.fixed=false, .coarse=2, .fine=0}, .detune=50, .attack=65, .decay=65, .sustain=0, .loop=true}
+    {.level=100, .pitch={.fixed=false, .coarse=1, .fine=0}, .detune=50, .attack=0, .decay=38, .sustain=0, .loop=true, .waveform=0}, 
+    {.level=70, .pitch={.fixed=false, .coarse=1, .fine=0}, .detune=50, .attack=65, .decay=65, .sustain=0, .loop=true, .waveform=0}, 
+    {.level=0, .pitch={.fixed=false, .coarse=1, .fine=0}, .detune=50, .attack=0, .decay=0, .sustain=100, .loop=false, .waveform=0}, 
+    {.level=80, .pitch={.fixed=false, .coarse=2, .fine=0}, .detune=50, .attack=65, .decay=65, .sustain=0, .loop=true, .waveform=0}
   }
 };
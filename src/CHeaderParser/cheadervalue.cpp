@@ -71,6 +71,8 @@ const char *CHeaderValue::toString() const
 
 int CHeaderValue::toInt() const
 {
+  if (type == Type::Null) //missing keys read as 0 so older headers stay loadable
+    return 0;
   return value.intValue;
 }
 
@@ -81,6 +83,8 @@ double CHeaderValue::toDouble() const
 
 bool CHeaderValue::toBool() const
 {
+  if (type == Type::Null)
+    return false;
   return value.boolValue;
 }
 
@@ -22,31 +22,106 @@
  * SOFTWARE.                                                                      *
  **********************************************************************************/
 
+#include <algorithm>
+#include <cstring>
 #include <QIODevice>
 #include "FMSynth/Voice.h"
+#include "FMSynth/VoiceBank.h"
 #include "fmproject.h"
 #include "fmsong.h"
 #include "FMSource.h"
 #include "globals.h"
 
-FMSource::FMSource(int numChannels)
+template<unsigned Samplerate> class FMSource::RateCompiledPatch : public FMSource::CompiledPatch
+{
+  public:
+    void compile(const FMSynth::Patch &patch) override
+    {
+      source = patch;
+      valid = true;
+      compiled = FMSynth::CompiledPatch<Samplerate>::compile(patch);
+    }
+    FMSynth::CompiledPatch<Samplerate> compiled;
+};
+
+//All voices of a channel in SIMD banks of BANK_LANES voices, voice i is lane i % BANK_LANES of bank
+//i / BANK_LANES. Every lane renders exactly what a lone FMSynth::Voice would, a bank just renders them
+//all at once.
+template<unsigned Samplerate> class FMSource::RateSynth : public FMSource::Synth
+{
+  public:
+    RateSynth(int polyphony) : banks(new Bank[(polyphony + BANK_LANES - 1) / BANK_LANES]), numBanks((polyphony + BANK_LANES - 1) / BANK_LANES) {}
+    ~RateSynth() {delete[] banks;}
+    void noteOn(int voice, const FMSynth::Patch &patch, uint8_t note, uint8_t velocity) override {banks[voice / BANK_LANES].noteOn(voice % BANK_LANES, patch, note, velocity);}
+    void noteOn(int voice, const CompiledPatch &patch, uint8_t note, uint8_t velocity) override {banks[voice / BANK_LANES].noteOn(voice % BANK_LANES, static_cast<const RateCompiledPatch<Samplerate>&>(patch).compiled, note, velocity);}
+    void noteOff(int voice) override {banks[voice / BANK_LANES].noteOff(voice % BANK_LANES);}
+    void reset(int voice) override {banks[voice / BANK_LANES].reset(voice % BANK_LANES);}
+    uint8_t midikey(int voice) const override {return banks[voice / BANK_LANES].midikey(voice % BANK_LANES);}
+    void renderAdd(int32_t *bus, qint64 frames) override
+    {
+      for (int i = 0; i < numBanks; ++i)
+        banks[i].renderAdd(bus, frames);
+    }
+    bool released(int voice) const override {return banks[voice / BANK_LANES].released(voice % BANK_LANES);}
+    bool finished(int voice) const override {return banks[voice / BANK_LANES].finished(voice % BANK_LANES);}
+    int32_t masterGain(int voice) const override {return banks[voice / BANK_LANES].masterGain(voice % BANK_LANES);}
+    void setBandlimited(bool enabled) override
+    {
+      for (int i = 0; i < numBanks * BANK_LANES; ++i)
+        banks[i / BANK_LANES].setBandlimited(i % BANK_LANES, enabled);
+    }
+  private:
+    typedef FMSynth::VoiceBank<Samplerate, BANK_LANES> Bank;
+    Bank *banks;
+    int numBanks;
+};
+
+FMSource::FMSource(int numChannels, unsigned samplerate, SampleFormat format, int polyphony)
 {
   open(QIODevice::ReadOnly);
+  _samplerate = (isSupportedVoiceRate(samplerate)) ? samplerate:8000;
+  _format = format;
   _numChannels = numChannels;
+  _polyphony = polyphony;
+  _voiceAllocation = VoiceAllocation::FirstFree;
+  _stealPolicy = StealPolicy::Oldest;
   _channels = new Channel[numChannels];
-  _song = nullptr;
+  _pool = new Voice[numChannels * polyphony];
+  for (int i = 0; i < numChannels * polyphony; ++i)
+    _pool[i].index = i % polyphony;
+  for (int i = 0; i < numChannels; ++i)
+  {
+    _channels[i].synth = createSynth(_samplerate, polyphony);
+    _channels[i].pool = _pool + i * polyphony;
+    _channels[i].voices.reserve(polyphony);
+    _channels[i].active.reserve(polyphony);
+    _channels[i].nextEvent = 0;
+    _channels[i].patch = nullptr;
+    _channels[i].gain_Q10 = 1 << 10;
+  }
+  _ditherState = 0x12345678;
+  _dither = false;
+  _tempo = 0;
+  _sample = 0;
+  baseTempo = 0;
 }
 
 FMSource::~FMSource()
 {
   close();
+  for (int i = 0; i < _numChannels; ++i)
+  {
+    delete _channels[i].synth;
+    for (auto patch : _channels[i].patches)
+      delete patch;
+  }
   delete[] _channels;
-  _song = nullptr;
+  delete[] _pool;
 }
 
 void FMSource::setTempo(uint32_t tempo)
 {
-  _tempo = 8 * 60000 / tempo;
+  _tempo = _samplerate * 60 / tempo;
   baseTempo = tempo;
 }
 
@@ -55,154 +130,614 @@ int FMSource::getBaseTempo()
   return baseTempo;
 }
 
-void FMSource::playSong(FMSong *song)
+bool FMSource::isSupportedSamplerate(unsigned samplerate)
+{
+  return samplerate == 8000 || samplerate == 16000 || samplerate == 22050 || samplerate == 44100 || samplerate == 48000;
+}
+
+bool FMSource::isSupportedVoiceRate(unsigned samplerate)
+{
+  return isSupportedSamplerate(samplerate) || samplerate == 32000 || samplerate == 64000 || samplerate == 88200;
+}
+
+void FMSource::setVoiceAllocation(VoiceAllocation allocation)
 {
-  _song = song;
+  _voiceAllocation = allocation;
+}
+
+void FMSource::setStealPolicy(StealPolicy policy)
+{
+  _stealPolicy = policy;
+}
+
+void FMSource::setChannelGain(int channel, float gain)
+{
+  _channels[channel].gain_Q10 = (int32_t)(gain * (1 << 10) + 0.5f);
+}
+
+void FMSource::setDither(bool enabled)
+{
+  _dither = enabled;
+}
+
+void FMSource::setBandlimited(bool enabled)
+{
+  for (int i = 0; i < _numChannels; ++i)
+    _channels[i].synth->setBandlimited(enabled);
+}
+
+//Sections become Section events switching the channel to their compiled instrument followed by their notes
+FMSource::Score *FMSource::compileSong(FMSong *song, unsigned samplerate, uint32_t tempo)
+{
+  Score *score = new Score;
+  uint32_t beat;
+  samplerate = (isSupportedVoiceRate(samplerate)) ? samplerate:8000;
+  beat = (tempo > 0) ? samplerate * 60 / tempo:0;
+  score->tracks.resize(4);
   for (int i = 0; i < 4; ++i)
-    _channels[i].section = 0;
+  {
+    QVector<Section> sections;
+    for (int j = 0; j < song->numSections(i); ++j)
+    {
+      FMSong::Section *section = song->getSection(i, j);
+      Section s;
+      s.start = samples(beat, section->offset - 1);
+      //A section's remaining notes are dropped once the next section starts
+      s.cut = (j + 1 < song->numSections(i)) ? samples(beat, song->getSection(i, j + 1)->offset - 1):UINT32_MAX;
+      s.patch = section->instrument;
+      s.notes = &section->pattern->notes;
+      sections += s;
+    }
+    score->tracks[i].channel = i;
+    compileTrack(sections, beat, samplerate, score->tracks[i].events, score->tracks[i].patches);
+  }
+  return score;
+}
+
+FMSource::Score *FMSource::compilePattern(int channel, const QList<FMSong::Note> &notes, const FMSynth::Patch &patch, unsigned samplerate, uint32_t tempo)
+{
+  Score *score = new Score;
+  Section section;
+  uint32_t beat;
+  samplerate = (isSupportedVoiceRate(samplerate)) ? samplerate:8000;
+  beat = (tempo > 0) ? samplerate * 60 / tempo:0;
+  section.start = 0;
+  section.cut = UINT32_MAX;
+  section.patch = &patch;
+  section.notes = &notes;
+  score->tracks.resize(1);
+  score->tracks[0].channel = channel;
+  compileTrack(QVector<Section>() << section, beat, samplerate, score->tracks[0].events, score->tracks[0].patches);
+  return score;
+}
+
+void FMSource::play(Score *score)
+{
+  for (auto &track : score->tracks)
+  {
+    Channel &c = _channels[track.channel];
+    c.events.swap(track.events);
+    c.patches.swap(track.patches);
+    c.nextEvent = 0;
+    c.patch = nullptr;
+  }
+  //The score now holds what its channels played before
+  delete score;
   _sample = 0;
 }
 
+void FMSource::playSong(FMSong *song)
+{
+  play(compileSong(song, _samplerate, baseTempo));
+}
+
 void FMSource::stopSong()
 {
   for (int i = 0; i < _numChannels; ++i)
   {
     Channel &channel = _channels[i];
     for (auto voice : channel.voices)
-      delete voice;
+      voice->active = false;
     channel.voices.clear();
-    channel.notes.clear();
-    channel.section = -1;
+    channel.active.clear();
+    channel.events.clear();
+    channel.nextEvent = 0;
   }
-  _song = nullptr;
-}
-
-void FMSource::playPattern(int channel, const QList<FMSong::Note> &notes, const FMSynth::Patch &patch)
-{
-  _channels[channel].notes = notes;
-  _channels[channel].patch = patch;
-  _channels[channel].offset = 0;
-  _sample = 0;
 }
 
 void FMSource::stopPattern(int channel)
 {
-  _channels[channel].notes.clear();
+  _channels[channel].events.clear();
+  _channels[channel].nextEvent = 0;
   for (auto voice : _channels[channel].voices)
-    delete voice;
+    voice->active = false;
   _channels[channel].voices.clear();
+  _channels[channel].active.clear();
 }
 
 void FMSource::noteOn(int channel, const FMSynth::Patch &patch, uint8_t note, int duration, uint8_t velocity)
 {
-  bool foundOne = false;
-  for (auto voice : _channels[channel].voices)
+  int voice = startNote(channel, samples(duration), true);
+  _channels[channel].synth->noteOn(voice, patch, note, velocity);
+}
+
+bool FMSource::atEnd() const
+{
+  for (int i = 0; i < _numChannels; ++i)
   {
-    if (voice->samples == 0)
-    {
-      voice->synth.noteOn(patch, note, velocity);
-      voice->samples = samples(duration);
-      foundOne = true;
-      break;
-    }
+    if (!channelAtEnd(i))
+      return false;
   }
-  if (!foundOne)
+  return true;
+}
+
+bool FMSource::channelAtEnd(int channel) const
+{
+  Channel &c = _channels[channel];
+  if (!c.active.isEmpty())
+    return false;
+  for (auto voice : c.voices)
   {
-    Voice *voice = new Voice;
-    voice->synth.noteOn(patch, note, velocity);
-    voice->samples = samples(duration);
-    _channels[channel].voices += voice;
+    if (voice->held)
+      return false;
   }
+  return c.nextEvent >= c.events.size();
 }
 
-bool FMSource::atEnd() const
+QVector<uint8_t> FMSource::playingKeys(int channel) const
 {
-  for (int i = 0; i < _numChannels; ++i)
+  Channel &c = _channels[channel];
+  QVector<uint8_t> keys;
+  for (auto voice : c.voices)
   {
-    Channel &channel = _channels[i];
-    for (auto voice : channel.voices)
+    if (voice->active)
+      keys += c.synth->midikey(voice->index);
+  }
+  return keys;
+}
+
+//Renders a single channel ignoring all others, adding it onto bus. Used by SongRenderer to render each
+//channel on its own thread, since the bus is a plain sum the channels can be added up in any order.
+void FMSource::renderChannel(int channel, int32_t *bus, qint64 numSamples)
+{
+  while (numSamples > 0)
+  {
+    qint64 length = (numSamples > BLOCK_SIZE) ? BLOCK_SIZE:numSamples;
+    processEvents(channel);
+    if (nextEvent(channel) - _sample < length)
+      length = nextEvent(channel) - _sample;
+    mixChannel(channel, bus, length);
+    bus += length;
+    numSamples -= length;
+    _sample += length;
+  }
+}
+
+void FMSource::noteOff(int channel)
+{
+  Channel &c = _channels[channel];
+  for (auto voice : c.voices)
+  {
+    c.synth->noteOff(voice->index);
+    if (voice->held)
+      voice->end = _sample;
+    voice->held = false;
+  }
+}
+
+//Mixes all channels into numSamples samples of the source's format
+qint64 FMSource::render(void *out, qint64 numSamples)
+{
+  uint8_t *data = (uint8_t*)out;
+  int sampleSize = bytesPerSample(_format);
+  qint64 total = 0;
+  while (numSamples > 0)
+  {
+    qint64 length = (numSamples > BLOCK_SIZE) ? BLOCK_SIZE:numSamples;
+    int numActive = 0;
+    for (int i = 0; i < _numChannels; ++i)
     {
-      if (!voice->synth.finished())
-        return false;
-      else if (voice->samples > 0)
-        return false;
+      processEvents(i);
+      if (nextEvent(i) - _sample < length)
+        length = nextEvent(i) - _sample;
+      numActive += _channels[i].active.size();
     }
-    if (channel.notes.size() > 0)
-      return false;
-    if (_song != nullptr && i < 4)
+    //Nothing sounding, the block is plain silence up to the next event
+    if (numActive == 0)
+      silence(data, length, _format);
+    else
     {
-      if (channel.section < _song->numSections(i))
-        return false;
+      memset(_bus, 0, length * sizeof(int32_t));
+      for (int i = 0; i < _numChannels; ++i)
+        mixChannel(i, _bus, length);
+      convert(_bus, data, length, _format, (_dither) ? &_ditherState:nullptr);
     }
+    data += length * sampleSize;
+    total += length;
+    numSamples -= length;
+    _sample += length;
   }
-  return true;
+  return total;
 }
 
-void FMSource::noteOff(int channel)
+//Final output stage. The bus is clamped once here instead of after every voice. Dither only applies to
+//8-bit output, 16-bit and float can represent the bus exactly.
+void FMSource::convert(const int32_t *bus, void *out, qint64 numSamples, SampleFormat format, uint32_t *dither)
 {
-  for (auto voice : _channels[channel].voices)
+  if (format == SampleFormat::UInt8)
   {
-    voice->synth.noteOff();
-    voice->samples = 0;
+    uint8_t *data = (uint8_t*)out;
+    for (qint64 i = 0; i < numSamples; ++i)
+    {
+      int32_t v = bus[i];
+      if (dither != nullptr)
+      {
+        //Triangular (TPDF) dither of +/-1 LSB from two uniform values, then rounded to nearest so the
+        //shift doesn't bias the output half an LSB down
+        uint32_t x = *dither;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        *dither = x;
+        v = 128 + ((v + (int32_t)(x & 0xFF) + (int32_t)((x >> 8) & 0xFF) - 255 + (1 << 7)) >> 8);
+      }
+      else
+        v = 128 + v / (1 << 8);
+      data[i] = (v < 0) ? 0:((v > 255) ? 255:v);
+    }
+  }
+  else if (format == SampleFormat::Int16)
+  {
+    int16_t *data = (int16_t*)out;
+    for (qint64 i = 0; i < numSamples; ++i)
+      data[i] = (bus[i] < -32768) ? -32768:((bus[i] > 32767) ? 32767:bus[i]);
+  }
+  else
+  {
+    float *data = (float*)out;
+    for (qint64 i = 0; i < numSamples; ++i)
+    {
+      float v = bus[i] / 32768.0f;
+      data[i] = (v < -1.0f) ? -1.0f:((v > 1.0f) ? 1.0f:v);
+    }
   }
 }
 
+int FMSource::bytesPerSample(SampleFormat format)
+{
+  if (format == SampleFormat::Int16)
+    return sizeof(int16_t);
+  else if (format == SampleFormat::Float)
+    return sizeof(float);
+  return sizeof(uint8_t);
+}
+
 qint64 FMSource::readData(char *data, qint64 maxSize)
 {
-  qint64 bufferSize = (maxSize > 512) ? 512:maxSize;
-  for (qint64 i = 0; i < bufferSize; ++i)
+  int sampleSize = bytesPerSample(_format);
+  qint64 numSamples = maxSize / sampleSize;
+  return render(data, (numSamples > BLOCK_SIZE) ? BLOCK_SIZE:numSamples) * sampleSize;
+}
+
+qint64 FMSource::writeData(const char *data, qint64 maxSize)
+{
+  Q_UNUSED(data);
+  Q_UNUSED(maxSize);
+  return 0;
+}
+
+//Turns the sections of a channel into its events, compiling every distinct instrument into patches
+void FMSource::compileTrack(const QVector<Section> &sections, uint32_t beat, unsigned samplerate, QVector<Event> &events, QVector<CompiledPatch*> &patches)
+{
+  QVector<QVector<uint32_t>> times(sections.size());
+  for (int i = 0; i < sections.size(); ++i)
   {
-    uint8_t byte = 128;
-    bool first = true;
-    for (int i = 0; i < _numChannels; ++i)
+    for (auto &note : *sections[i].notes)
+      times[i] += samples(beat, note.offset - 1) + sections[i].start;
+  }
+  for (int i = 0; i < sections.size(); ++i)
+  {
+    const Section &section = sections[i];
+    Event event;
+    event.sample = section.start;
+    event.type = Event::Type::Section;
+    event.patch = nullptr;
+    for (auto patch : patches)
+    {
+      if (patch->matches(*section.patch))
+        event.patch = patch;
+    }
+    if (event.patch == nullptr)
     {
-      Channel &channel = _channels[i];
-      if (_song != nullptr && i < 4)
+      CompiledPatch *patch = createCompiledPatch(samplerate);
+      patch->compile(*section.patch);
+      patches += patch;
+      event.patch = patch;
+    }
+    events += event;
+    for (int j = 0; j < section.notes->size(); ++j)
+    {
+      const FMSong::Note &note = section.notes->at(j);
+      Event event;
+      if (times[i][j] >= section.cut)
+        continue;
+      event.sample = times[i][j];
+      event.type = Event::Type::Note;
+      event.patch = nullptr;
+      event.length = samples(beat, note.duration);
+      event.midikey = note.midikey;
+      event.velocity = note.velocity;
+      event.release = true;
+      if (event.length > 0)
       {
-        if (channel.section < _song->numSections(i))
+        //Notes followed closely by the next note of the same section aren't released so the next note
+        //takes over the still sounding voice (legato/glide)
+        uint32_t end = event.sample + event.length - 1;
+        int s = i;
+        while (s + 1 < sections.size() && sections[s + 1].start <= end)
+          ++s;
+        for (auto next : times[s])
         {
-          FMSong::Section *section = _song->getSection(i, channel.section);
-          if (_sample == samples(section->offset - 1))
+          if (next > end)
           {
-            channel.notes = section->pattern->notes;
-            channel.patch = *section->instrument;
-            channel.offset = _sample;
-            ++channel.section;
+            event.release = end + samples(beat, 0) / 2 < next;
+            break;
           }
         }
       }
-      while (channel.notes.size() > 0 && _sample == samples(channel.notes[0].offset - 1) + channel.offset)
+      events += event;
+    }
+  }
+  std::stable_sort(events.begin(), events.end(), [](const Event &a, const Event &b) {return a.sample < b.sample;});
+}
+
+//Claims a voice for a note of length samples in the order of the voice allocation (see VoiceAllocation),
+//the caller starts it with the patch it has at hand
+int FMSource::startNote(int channel, uint32_t length, bool release)
+{
+  Channel &c = _channels[channel];
+  Voice *voice = nullptr;
+  if (_voiceAllocation == VoiceAllocation::FirstFree)
+  {
+    for (auto v : c.voices)
+    {
+      if (!v->held)
       {
-        FMSong::Note note = channel.notes.takeFirst();
-        noteOn(i, channel.patch, note.midikey, note.duration, note.velocity);
+        voice = v;
+        break;
       }
-      for (auto voice : channel.voices)
+    }
+  }
+  else
+  {
+    for (auto v : c.voices)
+    {
+      if (!v->held && v->active && !c.synth->released(v->index))
       {
-        if (!voice->synth.finished())
-        {
-          if (voice->samples > 0)
-          {
-            --voice->samples;
-            if ((voice->samples == 0) && (channel.notes.size() == 0 || _sample + samples(0) / 2 < samples(channel.notes[0].offset - 1) + channel.offset))
-              voice->synth.noteOff();
-          }
-          if (first)
-            byte = voice->synth.update();
-          else
-            byte = mix(byte, voice->synth.update());
-          first = false;
-        }
+        voice = v;
+        break;
       }
     }
-    *data++ = (char)byte;
-    ++_sample;
+    for (int i = 0; voice == nullptr && i < c.voices.size(); ++i)
+    {
+      if (!c.voices[i]->active)
+        voice = c.voices[i];
+    }
+  }
+  if (voice == nullptr && c.voices.size() < _polyphony)
+  {
+    //Pool slots are handed out in order and keep their position, a fresh slot starts from a clean voice
+    voice = c.pool + c.voices.size();
+    c.synth->reset(voice->index);
+    c.voices += voice;
   }
-  return bufferSize;
+  //With FirstFree every voice left holds a note, so there is no released one to steal
+  if (voice == nullptr)
+    voice = stealVoice(channel, false);
+  if (voice == nullptr)
+    voice = stealVoice(channel, true);
+  if (!voice->active)
+  {
+    voice->active = true;
+    c.active += voice;
+  }
+  voice->start = _sample;
+  voice->held = length > 0;
+  voice->end = _sample + length - 1;
+  voice->release = release;
+  return voice->index;
 }
 
-qint64 FMSource::writeData(const char *data, qint64 maxSize)
+//Starts every event due at the current sample and releases voices whose note has ended
+void FMSource::processEvents(int channel)
 {
-  Q_UNUSED(data);
-  Q_UNUSED(maxSize);
-  return 0;
+  Channel &c = _channels[channel];
+  while (c.nextEvent < c.events.size() && c.events[c.nextEvent].sample <= _sample)
+  {
+    const Event &event = c.events[c.nextEvent++];
+    if (event.type == Event::Type::Section)
+      c.patch = event.patch;
+    else
+    {
+      int voice = startNote(channel, event.length, event.release);
+      c.synth->noteOn(voice, *c.patch, event.midikey, event.velocity);
+    }
+  }
+  for (auto voice : c.voices)
+  {
+    if (voice->held && voice->end <= _sample)
+    {
+      voice->held = false;
+      if (voice->release)
+        c.synth->noteOff(voice->index);
+    }
+  }
+}
+
+//Returns the sample position of the channel's next event or note end
+uint32_t FMSource::nextEvent(int channel)
+{
+  Channel &c = _channels[channel];
+  uint32_t next = (c.nextEvent < c.events.size()) ? c.events[c.nextEvent].sample:UINT32_MAX;
+  for (auto voice : c.voices)
+  {
+    if (voice->held && voice->end < next)
+      next = voice->end;
+  }
+  return next;
+}
+
+//Drops a finished voice from the channel's active list, its slot stays allocated until the next note reuses it
+void FMSource::retireVoice(Channel &channel, int index)
+{
+  channel.active[index]->active = false;
+  channel.active.remove(index);
+}
+
+//Picks the sounding voice to cut off among the held (held) or released voices of the channel by the steal
+//policy, nullptr if there is none
+FMSource::Voice *FMSource::stealVoice(int channel, bool held)
+{
+  Channel &c = _channels[channel];
+  Voice *voice = nullptr;
+  for (auto v : c.voices)
+  {
+    if (!v->active || v->held != held)
+      continue;
+    if (voice == nullptr)
+    {
+      voice = v;
+      continue;
+    }
+    switch (_stealPolicy)
+    {
+      case StealPolicy::Oldest:
+        if (v->start < voice->start)
+          voice = v;
+        break;
+      case StealPolicy::Quietest:
+        if (c.synth->masterGain(v->index) < c.synth->masterGain(voice->index))
+          voice = v;
+        break;
+      case StealPolicy::ReleasedFirst:
+        if (v->end < voice->end)
+          voice = v;
+        break;
+    }
+  }
+  return voice;
+}
+
+//Adds every active voice of a channel onto the bus, the channel gain applies to the sum of its voices
+void FMSource::mixChannel(int channel, int32_t *bus, qint64 length)
+{
+  Channel &c = _channels[channel];
+  if (c.active.isEmpty())
+    return;
+  if (c.gain_Q10 == (1 << 10))
+    c.synth->renderAdd(bus, length);
+  else
+  {
+    memset(_buffer, 0, length * sizeof(int32_t));
+    c.synth->renderAdd(_buffer, length);
+    for (qint64 i = 0; i < length; ++i)
+      bus[i] += ((int64_t)_buffer[i] * c.gain_Q10) >> 10;
+  }
+  for (int i = 0; i < c.active.size();)
+  {
+    if (c.synth->finished(c.active[i]->index))
+      retireVoice(c, i);
+    else
+      ++i;
+  }
+}
+
+void FMSource::silence(void *out, qint64 numSamples, SampleFormat format)
+{
+  if (format == SampleFormat::UInt8)
+    memset(out, 128, numSamples);
+  else
+    memset(out, 0, numSamples * bytesPerSample(format));
+}
+
+FMSource::Score::~Score()
+{
+  for (auto &track : tracks)
+  {
+    for (auto patch : track.patches)
+      delete patch;
+  }
+}
+
+uint32_t FMSource::Score::length() const
+{
+  uint32_t length = 0;
+  for (auto &track : tracks)
+  {
+    for (auto &event : track.events)
+    {
+      if (event.type == Event::Type::Note && event.sample + event.length > length)
+        length = event.sample + event.length;
+    }
+  }
+  return length;
+}
+
+FMSource::Score *FMSource::Score::takeChannel(int channel)
+{
+  Score *score = new Score;
+  for (int i = 0; i < tracks.size(); ++i)
+  {
+    if (tracks[i].channel == channel)
+    {
+      score->tracks += tracks[i];
+      tracks.remove(i);
+      break;
+    }
+  }
+  return score;
+}
+
+FMSource::Synth *FMSource::createSynth(unsigned samplerate, int polyphony)
+{
+  switch (samplerate)
+  {
+    case 16000:
+      return new RateSynth<16000>(polyphony);
+    case 22050:
+      return new RateSynth<22050>(polyphony);
+    case 44100:
+      return new RateSynth<44100>(polyphony);
+    case 48000:
+      return new RateSynth<48000>(polyphony);
+    case 32000:
+      return new RateSynth<32000>(polyphony);
+    case 64000:
+      return new RateSynth<64000>(polyphony);
+    case 88200:
+      return new RateSynth<88200>(polyphony);
+  }
+  return new RateSynth<8000>(polyphony);
+}
+
+FMSource::CompiledPatch *FMSource::createCompiledPatch(unsigned samplerate)
+{
+  switch (samplerate)
+  {
+    case 16000:
+      return new RateCompiledPatch<16000>;
+    case 22050:
+      return new RateCompiledPatch<22050>;
+    case 44100:
+      return new RateCompiledPatch<44100>;
+    case 48000:
+      return new RateCompiledPatch<48000>;
+    case 32000:
+      return new RateCompiledPatch<32000>;
+    case 64000:
+      return new RateCompiledPatch<64000>;
+    case 88200:
+      return new RateCompiledPatch<88200>;
+  }
+  return new RateCompiledPatch<8000>;
 }
@@ -25,59 +25,205 @@
 #ifndef FMSOURCE_H
 #define FMSOURCE_H
 
+#include <cstring>
 #include <QIODevice>
-#include "FMSynth/Voice.h"
+#include <QVector>
+#include "FMSynth/Patch.h"
 #include "fmsong.h"
 
 class FMSource : public QIODevice
 {
   public:
-    FMSource(int numChannels);
+    //Output formats of the final conversion stage, voices are always mixed on a 32-bit bus where one
+    //voice at full scale spans the signed 16-bit range
+    enum class SampleFormat {UInt8, Int16, Float};
+    //How a note finds a voice. FirstFree (the default, as the original synth did) takes the first voice not
+    //holding a note even if it still sounds its release. SilentFirst keeps release tails: it takes over a voice
+    //a legato note left sounding, then a silent voice, and only then cuts off a released voice.
+    //Either way a held voice is stolen only when every voice holds a note.
+    enum class VoiceAllocation {FirstFree, SilentFirst};
+    //Voice to steal among the released (SilentFirst) or held voices of a channel: the one started first, the
+    //one with the lowest level or the one released (or due to be released) first
+    enum class StealPolicy {Oldest, Quietest, ReleasedFirst};
+    static constexpr int DEFAULT_POLYPHONY = 16;
+    //8000, 16000, 22050, 44100 and 48000 Hz are supported, anything else falls back to 8000 Hz
+    static bool isSupportedSamplerate(unsigned samplerate);
+    //Besides those the voices also run at 32000, 64000 and 88200 Hz (4x 8000, 16000 and 22050 Hz) so
+    //SongRenderer can render oversampled, FMSource accepts any of these rates
+    static bool isSupportedVoiceRate(unsigned samplerate);
+    FMSource(int numChannels, unsigned samplerate=8000, SampleFormat format=SampleFormat::UInt8, int polyphony=DEFAULT_POLYPHONY);
     ~FMSource();
     void setTempo(uint32_t tempo);
     int getBaseTempo();
+    unsigned getSamplerate() const {return _samplerate;}
+    SampleFormat getFormat() const {return _format;}
+    void setVoiceAllocation(VoiceAllocation allocation);
+    void setStealPolicy(StealPolicy policy);
+    void setChannelGain(int channel, float gain);
+    void setDither(bool enabled);
+    //Band-limited (PolyBLEP) square and saw operators, worth it at 44100 and 48000 Hz where the naive
+    //ones alias audibly. Takes effect with the next note.
+    void setBandlimited(bool enabled);
+    class Score;
+    //Compile a song, or a pattern played on channel with patch, into a Score for a source running at
+    //samplerate. tempo is in beats per minute. The score keeps no reference to song, notes or patch.
+    static Score *compileSong(FMSong *song, unsigned samplerate, uint32_t tempo);
+    static Score *compilePattern(int channel, const QList<FMSong::Note> &notes, const FMSynth::Patch &patch, unsigned samplerate, uint32_t tempo);
+    //Starts score on the channels it has events for. The source takes the score over and frees what those
+    //channels played before. score has to be compiled for the source's sample rate.
+    void play(Score *score);
+    //Same as play(compileSong(song, getSamplerate(), tempo)) with the tempo last set
     void playSong(FMSong *song);
     void stopSong();
-    void playPattern(int channel, const QList<FMSong::Note> &notes, const FMSynth::Patch &patch);
     void stopPattern(int channel);
     void noteOn(int channel, const FMSynth::Patch &patch, uint8_t note, int duration, uint8_t velocity=127);
     bool atEnd() const override;
-    inline uint32_t samples(int duration) {return (_tempo * (duration + 1)) / 32;}
+    bool channelAtEnd(int channel) const;
+    //Keys of the voices sounding on channel, in voice order
+    QVector<uint8_t> playingKeys(int channel) const;
+    qint64 render(void *out, qint64 numSamples);
+    void renderChannel(int channel, int32_t *bus, qint64 numSamples);
+    static void convert(const int32_t *bus, void *out, qint64 numSamples, SampleFormat format, uint32_t *dither=nullptr);
+    static int bytesPerSample(SampleFormat format);
+    static void silence(void *out, qint64 numSamples, SampleFormat format);
+    inline uint32_t samples(int duration) {return samples(_tempo, duration);}
   public slots:
     void noteOff(int channel);
   protected:
     qint64 readData(char *data, qint64 maxSize) override;
     qint64 writeData(const char *data, qint64 maxSize) override;
   private:
+    class CompiledPatch;
+    //Songs and patterns are compiled into a list of events with absolute sample positions (see Score),
+    //rendering then runs uninterrupted from one event (or note end) to the next
+    struct Event
+    {
+      enum class Type {Section, Note};
+      uint32_t sample;
+      Type type;
+      const CompiledPatch *patch;
+      uint32_t length;
+      uint8_t midikey;
+      uint8_t velocity;
+      bool release;
+    };
+    //Rate independent handle on the voices of a channel. The sample rate is picked at runtime but the voices
+    //run the FMSynth::Voice specialization for that rate, so its rate dependent constants stay compile time.
+    //Voices are addressed by their index in the channel's pool.
+    class Synth
+    {
+      public:
+        virtual ~Synth() {}
+        virtual void noteOn(int voice, const FMSynth::Patch &patch, uint8_t note, uint8_t velocity) = 0;
+        //patch has to come from createCompiledPatch() with the same sample rate
+        virtual void noteOn(int voice, const CompiledPatch &patch, uint8_t note, uint8_t velocity) = 0;
+        virtual void noteOff(int voice) = 0;
+        virtual void reset(int voice) = 0;
+        virtual uint8_t midikey(int voice) const = 0;
+        //Adds all voices onto bus
+        virtual void renderAdd(int32_t *bus, qint64 frames) = 0;
+        virtual bool released(int voice) const = 0;
+        virtual bool finished(int voice) const = 0;
+        virtual int32_t masterGain(int voice) const = 0;
+        virtual void setBandlimited(bool enabled) = 0;
+    };
+    //Rate independent handle on a FMSynth::CompiledPatch, scores compile every instrument they play once
+    //so starting a song note is a table copy instead of recomputing every rate and level
+    class CompiledPatch
+    {
+      public:
+        CompiledPatch() : valid(false) {}
+        virtual ~CompiledPatch() {}
+        virtual void compile(const FMSynth::Patch &patch) = 0;
+        //Sections compare contents rather than pointers, identical instruments share one compiled copy
+        bool matches(const FMSynth::Patch &patch) const {return valid && memcmp(&source, &patch, sizeof(FMSynth::Patch)) == 0;}
+      protected:
+        FMSynth::Patch source;
+        bool valid;
+    };
+    //Defined in FMSource.cpp, the only place that needs the FMSynth voice headers
+    template<unsigned Samplerate> class RateSynth;
+    template<unsigned Samplerate> class RateCompiledPatch;
+    //Bookkeeping of one voice slot, index is the voice it stands for in the channel's Synth
     struct Voice
     {
-      Voice() {}
-      Voice(const Voice&) = delete;
-      Voice& operator=(const Voice&) = delete;
-      FMSynth::Voice<8000> synth;
-      uint32_t samples;
+      Voice() : active(false), held(false) {}
+      int index;
+      uint32_t start;
+      uint32_t end;
+      bool active;
+      bool held;
+      bool release;
     };
+    //Voices are never allocated while playing, each channel draws from its own fixed slice of the pool
     struct Channel
     {
-      QList<Voice*> voices;
-      QList<FMSong::Note> notes;
-      FMSynth::Patch patch;
-      uint32_t offset;
-      int section;
+      Synth *synth;
+      Voice *pool;
+      QVector<Voice*> voices;
+      QVector<Voice*> active;
+      QVector<Event> events;
+      QVector<CompiledPatch*> patches;
+      int nextEvent;
+      const CompiledPatch *patch;
+      int32_t gain_Q10;
     };
-    inline uint8_t mix(uint8_t a, uint8_t b)
+    struct Section
     {
-      int32_t v = (int32_t)a + (int32_t)b - 127;
-      if(v < 0) return 0;
-      if(v > 0xFF) return 0xFF;
-      return v;
-    }
+      uint32_t start;
+      uint32_t cut;
+      const FMSynth::Patch *patch;
+      const QList<FMSong::Note> *notes;
+    };
+    static constexpr qint64 BLOCK_SIZE = 512;
+    static constexpr int BANK_LANES = 8;
+    static void compileTrack(const QVector<Section> &sections, uint32_t beat, unsigned samplerate, QVector<Event> &events, QVector<CompiledPatch*> &patches);
+    static uint32_t samples(uint32_t beat, int duration) {return ((int64_t)beat * (duration + 1)) / 32;}
+    int startNote(int channel, uint32_t length, bool release);
+    static void retireVoice(Channel &channel, int index);
+    Voice *stealVoice(int channel, bool held);
+    void processEvents(int channel);
+    uint32_t nextEvent(int channel);
+    void mixChannel(int channel, int32_t *bus, qint64 length);
+    static Synth *createSynth(unsigned samplerate, int polyphony);
+    static CompiledPatch *createCompiledPatch(unsigned samplerate);
     Channel *_channels;
-    FMSong *_song;
+    Voice *_pool;
+    int32_t _buffer[BLOCK_SIZE];
+    int32_t _bus[BLOCK_SIZE];
+    uint32_t _ditherState;
+    bool _dither;
+    unsigned _samplerate;
+    SampleFormat _format;
     uint32_t _tempo;
     uint32_t _sample;
     int _numChannels;
+    int _polyphony;
+    VoiceAllocation _voiceAllocation;
+    StealPolicy _stealPolicy;
     int baseTempo;
 };
 
+//A song or pattern compiled for playback: the events of every channel it plays, at absolute sample positions,
+//and a compiled copy of each instrument they use. A score owns all of it, so it can be compiled on the thread
+//that edits the song and then be played on another while the song is changed or deleted.
+class FMSource::Score
+{
+  public:
+    ~Score();
+    //Samples from the start to the end of the last note, not counting release tails
+    uint32_t length() const;
+    //Moves the part of channel into a score of its own, for sources that only render that channel
+    Score *takeChannel(int channel);
+  private:
+    friend class FMSource;
+    struct Track
+    {
+      int channel;
+      QVector<Event> events;
+      QVector<CompiledPatch*> patches;
+    };
+    QVector<Track> tracks;
+};
+
 #endif //FMSOURCE_H
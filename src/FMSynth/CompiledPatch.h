@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstdint>
+#include "FixedPoint/Fixed.h"
+#include "Patch.h"
+
+namespace FMSynth {
+
+template<unsigned Samplerate>
+class Voice;
+
+// A patch with everything Voice::noteOn derives from it worked out ahead of time for one sample rate:
+// operator levels and envelope rates, LFO, glide, volume, feedback and waveforms, plus the operator rates
+// of every MIDI key. noteOn(const CompiledPatch&, ...) then only copies values into the voice.
+// compile() is constexpr, so patches known at compile time (like instruments/*.h) can be compiled into
+// flash with no cost at runtime:
+//     constexpr FMSynth::CompiledPatch<8000> piano = FMSynth::CompiledPatch<8000>::compile(patch_piano);
+template<unsigned Samplerate>
+struct CompiledPatch {
+    
+    // Everything but the operator rates, which Voice::noteOn(const Patch&, ...) still computes per note
+    struct Setup {
+        
+        struct Envelope {
+            std::int32_t attack_rate_Q20;
+            std::int32_t decay_rate_Q20;
+            std::int32_t release_rate_Q20; // only used by the master envelope
+            std::int32_t sustain_Q10;
+            bool loop;
+        };
+        
+        std::int32_t op_levels_Q10[4];
+        bool op_fixed[4];
+        Envelope op_envs[4];
+        std::int32_t wave_masks[4][3];
+        bool waveforms; // some operator plays a square, saw or triangle
+        
+        Envelope master_env;
+        
+        std::uint32_t lfo_rate_Q32;
+        std::int32_t lfo_depth_Q10;
+        std::int32_t lfo_att_rate_Q20;
+        
+        bool glide;
+        std::int32_t glide_att_rate_Q20;
+        
+        std::int32_t volume_Q10; // before velocity is applied
+        std::int32_t fb_level_Q10;
+        std::uint8_t algorithm; // 0 - 10
+        
+        static constexpr Setup compile(const Patch& patch) {
+            using V = Voice<Samplerate>;
+            Setup setup{};
+            for(std::uint32_t idx = 0; idx < 4; ++idx) {
+                const Patch::Operator& op = patch.op[idx];
+                setup.op_levels_Q10[idx] = V::operatorLevel(op);
+                setup.op_fixed[idx] = op.pitch.fixed;
+                setup.op_envs[idx] = _envelope(op.attack, op.decay, op.sustain, 0, op.loop);
+                // Unknown waveforms play a sine
+                setup.wave_masks[idx][0] = op.waveform == Patch::Operator::Square ? -1 : 0;
+                setup.wave_masks[idx][1] = op.waveform == Patch::Operator::Saw ? -1 : 0;
+                setup.wave_masks[idx][2] = op.waveform == Patch::Operator::Triangle ? -1 : 0;
+                if(setup.wave_masks[idx][0] | setup.wave_masks[idx][1] | setup.wave_masks[idx][2]) setup.waveforms = true;
+            }
+            setup.master_env = _envelope(patch.attack, patch.decay, patch.sustain, patch.release, false);
+            
+            std::uint32_t lfo_freq_Q15 = V::toLFOFrequency(patch.lfo.speed).internal();
+            setup.lfo_rate_Q32 = (lfo_freq_Q15 / V::_CONTROLRATE) << (32 - 15);
+            setup.lfo_depth_Q10 = V::_percentToLevel(patch.lfo.pmd).internal() / 2;
+            setup.lfo_att_rate_Q20 = V::_durationToRate(V::_percentToDuration(patch.lfo.attack)).internal();
+            
+            setup.glide = patch.glide > 0;
+            setup.glide_att_rate_Q20 = V::_durationToRate(V::_percentToDuration(patch.glide)).internal();
+            
+            setup.volume_Q10 = V::_percentToLevel(patch.volume).internal();
+            setup.fb_level_Q10 = V::_percentToLevel(patch.feedback - 50).internal();
+            std::int32_t algo_idx = patch.algorithm - 1;
+            setup.algorithm = algo_idx <= 0 ? 0 : (algo_idx >= 10 ? 10 : algo_idx);
+            return setup;
+        }
+        
+        private:
+            
+            static constexpr Envelope _envelope(std::int8_t attack, std::int8_t decay, std::int8_t sustain, std::int8_t release, bool loop) {
+                using V = Voice<Samplerate>;
+                Envelope env{};
+                env.attack_rate_Q20 = V::_durationToRate(V::_percentToDuration(attack)).internal();
+                env.decay_rate_Q20 = V::_durationToRate(V::_percentToDuration(decay)).internal();
+                env.release_rate_Q20 = V::_durationToRate(V::_percentToDuration(release)).internal();
+                env.sustain_Q10 = (FixedPoint::Fixed<10>(sustain) / 100).internal();
+                env.loop = loop;
+                return env;
+            }
+    };
+    
+    Setup setup;
+    
+    // Operator rates (Q32) for every MIDI key
+    std::uint32_t rates_Q32[128][4];
+    
+    static constexpr CompiledPatch compile(const Patch& patch) {
+        CompiledPatch compiled{};
+        compiled.setup = Setup::compile(patch);
+        for(std::uint32_t key = 0; key < 128; ++key) {
+            for(std::uint32_t idx = 0; idx < 4; ++idx) compiled.rates_Q32[key][idx] = Voice<Samplerate>::operatorRate(patch.op[idx], key);
+        }
+        return compiled;
+    }
+};
+
+// A CompiledPatch cut down to the keys a song plays: the same setup, but operator rates only for
+// keys[0] to keys[count - 1] (ascending) instead of all 128 keys, so it costs sizeof(Setup) plus 17 bytes
+// per key rather than 2 KB of rates. FM Studio writes these with songs exported for a sample rate, see
+// Song. Voice::noteOn(const BakedPatch&, ...) starts notes from it like from a CompiledPatch.
+template<unsigned Samplerate>
+struct BakedPatch {
+    
+    typename CompiledPatch<Samplerate>::Setup setup;
+    const std::uint8_t* keys;
+    const std::uint32_t (*rates_Q32)[4];
+    std::uint8_t count;
+    
+    // Operator rates (Q32) of midikey, nullptr if it was not baked
+    constexpr const std::uint32_t* rates(std::int8_t midikey) const {
+        std::uint32_t first = 0, last = count;
+        while(first < last) {
+            std::uint32_t middle = (first + last) / 2;
+            if(keys[middle] < static_cast<std::uint8_t>(midikey)) first = middle + 1;
+            else last = middle;
+        }
+        return (first < count && keys[first] == static_cast<std::uint8_t>(midikey)) ? rates_Q32[first] : nullptr;
+    }
+};
+
+} // namespace FMSynth
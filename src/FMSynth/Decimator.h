@@ -0,0 +1,163 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Simd.h"
+
+namespace FMSynth {
+
+// Brings oversampled offline renders back to the target rate, decimating by 1, 2 or 4 with a cascade
+// of linear phase half-band FIR filters. All even taps of a half-band filter are zero except the center
+// one (0.5), so each stage splits its input into even and odd samples and only the odd ones go through
+// the symmetric side taps (polyphase form), Lane::Width outputs at a time.
+// Filters are centered on the kept samples: output n lines up with input n * factor, there is no delay.
+// Input is clamped to 16 bit before every stage like the final output stage does, which also keeps the
+// Q15 products of the 32 bit accumulators from overflowing.
+// A song is decimated as one stream fed in pieces of any size: process() holds back the last few outputs
+// until the input they look ahead to has arrived and finish() ends the stream as if it was followed by
+// silence, so the output doesn't depend on how the input was split up.
+class Decimator {
+    
+    public:
+        
+        // Most outputs finish() can return
+        static constexpr std::size_t MAX_FINISH = 32;
+        
+        explicit Decimator(unsigned factor): _factor(factor == 4 ? 4 : (factor == 2 ? 2 : 1)) {
+            _reset(_first, _WIDE_Q15);
+            _reset(_second, _NARROW_Q15);
+        }
+        
+        inline unsigned factor() const { return _factor; }
+        
+        // Number of samples process() and finish() return in total for a stream of frames input samples
+        inline std::size_t outputSize(std::size_t frames) const {
+            for(unsigned f = _factor; f > 1; f /= 2) frames = (frames + 1) / 2;
+            return frames;
+        }
+        
+        // Decimates the next frames samples of the stream from in to out and returns how many samples it
+        // wrote, at most frames. out may be the same buffer as in.
+        std::size_t process(const std::int32_t* in, std::size_t frames, std::int32_t* out) {
+            if(_factor == 4) {
+                _half.resize(frames);
+                frames = _stage(_first, in, frames, _half.data(), _WIDE_Q15);
+                in = _half.data();
+            }
+            if(_factor >= 2) return _stage(_second, in, frames, out, _NARROW_Q15);
+            if(in != out) {
+                for(std::size_t i = 0; i < frames; ++i) out[i] = in[i];
+            }
+            return frames;
+        }
+        
+        // Writes the outputs process() held back (at most MAX_FINISH) to out and returns their number,
+        // the decimator is then ready for the next stream
+        std::size_t finish(std::int32_t* out) {
+            if(_factor == 4) {
+                _half.resize(MAX_FINISH);
+                std::size_t count = _finish(_first, _half.data(), _WIDE_Q15);
+                count = _stage(_second, _half.data(), count, out, _NARROW_Q15);
+                return count + _finish(_second, out + count, _NARROW_Q15);
+            }
+            if(_factor == 2) return _finish(_second, out, _NARROW_Q15);
+            return 0;
+        }
+    
+    private:
+        
+        using Lane = typename Simd::Best<8>::Type;
+        
+        // Input of one stage that hasn't been consumed yet. It starts 2 * Taps samples before the next kept
+        // sample so it always holds the history the side taps reach back to (zeros at the start).
+        struct _Stream {
+            std::vector<std::int32_t> pending;
+            std::size_t frames;  // input samples since the start of the stream
+            std::size_t outputs; // output samples since the start of the stream
+        };
+        
+        // Side taps (offsets +-1, +-3, ...) in Q15 of Kaiser windowed half-band filters, the passband is
+        // flat to 0.1 dB up to 0.4 of the final output rate and the stopband is down by about 76 dB.
+        // _NARROW_Q15 (55 taps) is the last stage, it ends aliasing at 0.6 of the output rate.
+        // _WIDE_Q15 (19 taps) is the first stage of 4x, it only has to protect the band the second stage keeps.
+        static constexpr std::int32_t _NARROW_Q15[14] = {
+            10375, -3313, 1823, -1142, 743, -484, 308, -189, 110, -59, 29, -12, 4, -1
+        };
+        static constexpr std::int32_t _WIDE_Q15[5] = {
+            9989, -2335, 649, -117, 4
+        };
+        
+        template<std::size_t Taps>
+        static void _reset(_Stream& stream, const std::int32_t (&)[Taps]) {
+            stream.pending.assign(2 * Taps, 0);
+            stream.frames = 0;
+            stream.outputs = 0;
+        }
+        
+        // Takes frames more input samples and writes every output whose taps are all available
+        template<std::size_t Taps>
+        std::size_t _stage(_Stream& stream, const std::int32_t* in, std::size_t frames, std::int32_t* out, const std::int32_t (&taps_Q15)[Taps]) {
+            for(std::size_t i = 0; i < frames; ++i) {
+                stream.pending.push_back(in[i] > 32767 ? 32767 : (in[i] < -32768 ? -32768 : in[i]));
+            }
+            stream.frames += frames;
+            
+            // Output k of pending looks ahead to pending[2k + 4 * Taps - 1]
+            std::size_t size = stream.pending.size();
+            return _emit(stream, size >= 4 * Taps ? (size - 4 * Taps) / 2 + 1 : 0, out, taps_Q15);
+        }
+        
+        // Pads the stream with silence until every kept sample has an output, then starts a new stream
+        template<std::size_t Taps>
+        std::size_t _finish(_Stream& stream, std::int32_t* out, const std::int32_t (&taps_Q15)[Taps]) {
+            std::size_t count = (stream.frames + 1) / 2 - stream.outputs;
+            if(count > 0) {
+                stream.pending.resize(4 * Taps + 2 * (count - 1), 0);
+                _emit(stream, count, out, taps_Q15);
+            }
+            _reset(stream, taps_Q15);
+            return count;
+        }
+        
+        template<std::size_t Taps>
+        std::size_t _emit(_Stream& stream, std::size_t count, std::int32_t* out, const std::int32_t (&taps_Q15)[Taps]) {
+            if(count == 0) return 0;
+            
+            // Odd samples reach Taps outputs back and ahead, even samples are the kept ones
+            const std::int32_t* pending = stream.pending.data();
+            std::size_t size = stream.pending.size();
+            _even.resize(count);
+            _odd.resize(count + 2 * Taps);
+            for(std::size_t k = 0; k < count; ++k) _even[k] = pending[2 * Taps + 2 * k];
+            for(std::size_t i = 0; i < count + 2 * Taps; ++i) _odd[i] = (2 * i + 1 < size) ? pending[2 * i + 1] : 0;
+            
+            std::size_t n = 0;
+            for(; n + Lane::Width <= count; n += Lane::Width) _output<Lane>(n, out, taps_Q15);
+            for(; n < count; ++n) _output<Simd::Int32x1>(n, out, taps_Q15);
+            
+            stream.pending.erase(stream.pending.begin(), stream.pending.begin() + 2 * count);
+            stream.outputs += count;
+            return count;
+        }
+        
+        // out[n] = x[2n] / 2 + sum of taps_Q15[j] * (x[2n + 2j + 1] + x[2n - 2j - 1]), rounded
+        template<typename Vec, std::size_t Taps>
+        inline void _output(std::size_t n, std::int32_t* out, const std::int32_t (&taps_Q15)[Taps]) const {
+            const std::int32_t* odd = _odd.data() + Taps + n;
+            Vec acc = Vec::loadu(_even.data() + n).template sll<14>() + Vec::set1(1 << 14);
+            for(std::size_t j = 0; j < Taps; ++j) acc = acc + (Vec::loadu(odd + j) + Vec::loadu(odd - 1 - j)) * Vec::set1(taps_Q15[j]);
+            acc.template sra<15>().storeu(out + n);
+        }
+        
+        unsigned _factor;
+        
+        _Stream _first;  // 4x only
+        _Stream _second;
+        
+        std::vector<std::int32_t> _even;
+        std::vector<std::int32_t> _odd;
+        std::vector<std::int32_t> _half;
+};
+
+} // namespace FMSynth
@@ -49,6 +49,11 @@ class EnvelopeGenerator {
             }
         }
         
+        // Jumps straight to idle without a release slope
+        inline void stop() {
+            _setStage(Stage::Idle, 0);
+        }
+        
         inline void setAttackRate(const FixedPoint::Fixed<RATE_Q>& rate) {
             _rates_Q20[0] = rate.internal();
         }
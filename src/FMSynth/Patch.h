@@ -23,6 +23,8 @@ struct Patch {
     } lfo;
     
     struct Operator {
+        enum Waveform: std::uint8_t { Sine, Square, Saw, Triangle };
+        
         std::uint8_t level;//0 - 100
         
         struct Pitch {
@@ -37,6 +39,8 @@ struct Patch {
         std::int8_t decay;//0 - 100
         std::int8_t sustain;//0 - 100
         bool loop;
+        
+        std::uint8_t waveform;//0 - 3 (Waveform)
     } op[4];
 };
 
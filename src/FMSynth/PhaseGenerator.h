@@ -41,6 +41,11 @@ class PhaseGenerator {
         inline void trigger(std::int32_t phase_Q15) {
             _phase_Q32 = phase_Q15 << (32 - 15);
         }
+        
+        // Raw access to the phase accumulator, used when the state is moved to and from a VoiceBank
+        inline std::uint32_t phase() const { return _phase_Q32; }
+        inline void setPhase(std::uint32_t phase_Q32) { _phase_Q32 = phase_Q32; }
+        inline std::uint32_t rate() const { return _rate_Q32; }
     
     private:
     
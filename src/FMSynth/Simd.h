@@ -0,0 +1,175 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace FMSynth {
+
+namespace Simd {
+
+// Minimal set of 32 bit integer lane operations needed by the synth kernels. Every vector type
+// provides the same interface so kernels can be written once as templates over the lane type.
+// load/store need Width * 4 byte alignment, loadu/storeu don't.
+// All operations follow the semantics of the equivalent scalar int32 expression exactly (wrapping
+// multiply, arithmetic/logical shifts, division by a power of two rounding towards zero).
+
+struct Int32x1 {
+    
+    static constexpr unsigned Width = 1;
+    
+    std::int32_t v;
+    
+    static inline Int32x1 load(const std::int32_t* p) { return {*p}; }
+    static inline Int32x1 load(const std::uint32_t* p) { return {static_cast<std::int32_t>(*p)}; }
+    static inline Int32x1 loadu(const std::int32_t* p) { return {*p}; }
+    static inline Int32x1 set1(std::int32_t x) { return {x}; }
+    
+    inline void store(std::int32_t* p) const { *p = v; }
+    inline void storeu(std::int32_t* p) const { *p = v; }
+    inline void store(std::uint32_t* p) const { *p = static_cast<std::uint32_t>(v); }
+    
+    friend inline Int32x1 operator +(Int32x1 a, Int32x1 b) { return {static_cast<std::int32_t>(static_cast<std::uint32_t>(a.v) + static_cast<std::uint32_t>(b.v))}; }
+    friend inline Int32x1 operator -(Int32x1 a, Int32x1 b) { return {static_cast<std::int32_t>(static_cast<std::uint32_t>(a.v) - static_cast<std::uint32_t>(b.v))}; }
+    friend inline Int32x1 operator *(Int32x1 a, Int32x1 b) { return {static_cast<std::int32_t>(static_cast<std::uint32_t>(a.v) * static_cast<std::uint32_t>(b.v))}; }
+    friend inline Int32x1 operator &(Int32x1 a, Int32x1 b) { return {a.v & b.v}; }
+    
+    template<unsigned Shift> inline Int32x1 sll() const { return {static_cast<std::int32_t>(static_cast<std::uint32_t>(v) << Shift)}; }
+    template<unsigned Shift> inline Int32x1 srl() const { return {static_cast<std::int32_t>(static_cast<std::uint32_t>(v) >> Shift)}; }
+    template<unsigned Shift> inline Int32x1 sra() const { return {v >> Shift}; }
+    
+    // All bits set in lanes where the value is zero
+    inline Int32x1 isZero() const { return {v == 0 ? -1 : 0}; }
+    inline Int32x1 isNegative() const { return {v >> 31}; }
+    
+    // Picks a where mask is set and b elsewhere
+    static inline Int32x1 select(Int32x1 mask, Int32x1 a, Int32x1 b) { return {(mask.v & a.v) | (~mask.v & b.v)}; }
+    
+    inline Int32x1 clamp16() const { return {v > 32767 ? 32767 : (v < -32768 ? -32768 : v)}; }
+    
+    inline std::int32_t sum() const { return v; }
+};
+
+#if defined(__SSE2__) || defined(_M_X64)
+
+struct Int32x4 {
+    
+    static constexpr unsigned Width = 4;
+    
+    __m128i v;
+    
+    static inline Int32x4 load(const std::int32_t* p) { return {_mm_load_si128(reinterpret_cast<const __m128i*>(p))}; }
+    static inline Int32x4 load(const std::uint32_t* p) { return {_mm_load_si128(reinterpret_cast<const __m128i*>(p))}; }
+    static inline Int32x4 loadu(const std::int32_t* p) { return {_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))}; }
+    static inline Int32x4 set1(std::int32_t x) { return {_mm_set1_epi32(x)}; }
+    
+    inline void store(std::int32_t* p) const { _mm_store_si128(reinterpret_cast<__m128i*>(p), v); }
+    inline void storeu(std::int32_t* p) const { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+    inline void store(std::uint32_t* p) const { _mm_store_si128(reinterpret_cast<__m128i*>(p), v); }
+    
+    friend inline Int32x4 operator +(Int32x4 a, Int32x4 b) { return {_mm_add_epi32(a.v, b.v)}; }
+    friend inline Int32x4 operator -(Int32x4 a, Int32x4 b) { return {_mm_sub_epi32(a.v, b.v)}; }
+    friend inline Int32x4 operator &(Int32x4 a, Int32x4 b) { return {_mm_and_si128(a.v, b.v)}; }
+    
+    // SSE2 has no 32 bit low multiply, build it from two 32x32->64 bit multiplies of the even and odd lanes
+    friend inline Int32x4 operator *(Int32x4 a, Int32x4 b) {
+        __m128i even = _mm_mul_epu32(a.v, b.v);
+        __m128i odd = _mm_mul_epu32(_mm_srli_si128(a.v, 4), _mm_srli_si128(b.v, 4));
+        return {_mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)))};
+    }
+    
+    template<unsigned Shift> inline Int32x4 sll() const { return {_mm_slli_epi32(v, Shift)}; }
+    template<unsigned Shift> inline Int32x4 srl() const { return {_mm_srli_epi32(v, Shift)}; }
+    template<unsigned Shift> inline Int32x4 sra() const { return {_mm_srai_epi32(v, Shift)}; }
+    
+    inline Int32x4 isZero() const { return {_mm_cmpeq_epi32(v, _mm_setzero_si128())}; }
+    inline Int32x4 isNegative() const { return {_mm_srai_epi32(v, 31)}; }
+    
+    static inline Int32x4 select(Int32x4 mask, Int32x4 a, Int32x4 b) { return {_mm_or_si128(_mm_and_si128(mask.v, a.v), _mm_andnot_si128(mask.v, b.v))}; }
+    
+    inline Int32x4 clamp16() const {
+        const __m128i hi = _mm_set1_epi32(32767);
+        const __m128i lo = _mm_set1_epi32(-32768);
+        Int32x4 r = select({_mm_cmpgt_epi32(v, hi)}, {hi}, *this);
+        return select({_mm_cmplt_epi32(r.v, lo)}, {lo}, r);
+    }
+    
+    inline std::int32_t sum() const {
+        __m128i s = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+        s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtsi128_si32(s);
+    }
+};
+
+#endif
+
+#if defined(__AVX2__)
+
+struct Int32x8 {
+    
+    static constexpr unsigned Width = 8;
+    
+    __m256i v;
+    
+    static inline Int32x8 load(const std::int32_t* p) { return {_mm256_load_si256(reinterpret_cast<const __m256i*>(p))}; }
+    static inline Int32x8 load(const std::uint32_t* p) { return {_mm256_load_si256(reinterpret_cast<const __m256i*>(p))}; }
+    static inline Int32x8 loadu(const std::int32_t* p) { return {_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))}; }
+    static inline Int32x8 set1(std::int32_t x) { return {_mm256_set1_epi32(x)}; }
+    
+    inline void store(std::int32_t* p) const { _mm256_store_si256(reinterpret_cast<__m256i*>(p), v); }
+    inline void storeu(std::int32_t* p) const { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+    inline void store(std::uint32_t* p) const { _mm256_store_si256(reinterpret_cast<__m256i*>(p), v); }
+    
+    friend inline Int32x8 operator +(Int32x8 a, Int32x8 b) { return {_mm256_add_epi32(a.v, b.v)}; }
+    friend inline Int32x8 operator -(Int32x8 a, Int32x8 b) { return {_mm256_sub_epi32(a.v, b.v)}; }
+    friend inline Int32x8 operator *(Int32x8 a, Int32x8 b) { return {_mm256_mullo_epi32(a.v, b.v)}; }
+    friend inline Int32x8 operator &(Int32x8 a, Int32x8 b) { return {_mm256_and_si256(a.v, b.v)}; }
+    
+    template<unsigned Shift> inline Int32x8 sll() const { return {_mm256_slli_epi32(v, Shift)}; }
+    template<unsigned Shift> inline Int32x8 srl() const { return {_mm256_srli_epi32(v, Shift)}; }
+    template<unsigned Shift> inline Int32x8 sra() const { return {_mm256_srai_epi32(v, Shift)}; }
+    
+    inline Int32x8 isZero() const { return {_mm256_cmpeq_epi32(v, _mm256_setzero_si256())}; }
+    inline Int32x8 isNegative() const { return {_mm256_srai_epi32(v, 31)}; }
+    
+    static inline Int32x8 select(Int32x8 mask, Int32x8 a, Int32x8 b) { return {_mm256_blendv_epi8(b.v, a.v, mask.v)}; }
+    
+    inline Int32x8 clamp16() const { return {_mm256_max_epi32(_mm256_min_epi32(v, _mm256_set1_epi32(32767)), _mm256_set1_epi32(-32768))}; }
+    
+    inline std::int32_t sum() const {
+        __m128i s = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+        s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+        s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtsi128_si32(s);
+    }
+};
+
+#endif
+
+// Signed division by 2^Shift rounding towards zero, same as the "/ (1 << Shift)" used in the scalar code
+template<unsigned Shift, typename Vec>
+inline Vec divPow2(Vec x) {
+    return (x + (x.isNegative() & Vec::set1((1 << Shift) - 1))).template sra<Shift>();
+}
+
+// Widest lane type available in this build that evenly divides Lanes
+template<unsigned Lanes>
+struct Best {
+#if defined(__AVX2__)
+    using Type = typename std::conditional<Lanes % 8 == 0, Int32x8, typename std::conditional<Lanes % 4 == 0, Int32x4, Int32x1>::type>::type;
+#elif defined(__SSE2__) || defined(_M_X64)
+    using Type = typename std::conditional<Lanes % 4 == 0, Int32x4, Int32x1>::type;
+#else
+    using Type = Int32x1;
+#endif
+};
+
+} // namespace Simd
+
+} // namespace FMSynth
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include "Patch.h"
+
+namespace FMSynth {
+
+// Layout of songs exported by FM Studio as C headers. Everything is constexpr data so players on
+// microcontrollers can read it straight from flash. Times are in ticks, 32 per beat.
+// Songs exported for a sample rate also have a constexpr BakedPatch next to song for every instrument,
+// compiled_instruments[i] belongs to instruments[i] and goes to Voice::noteOn(const BakedPatch&, ...).
+// It only holds the operator rates of the keys the song plays on that instrument: about 200 bytes of
+// flash per instrument and 17 per key, where a full CompiledPatch takes over 2 KB. The header says how
+// much its baked instruments take.
+struct Song {
+    
+    // A note starts delta ticks after the previous note of its pattern (the first one after the start of
+    // the pattern) and is held for duration + 1 ticks. Notes starting together keep their order.
+    struct Note {
+        std::uint16_t delta;
+        std::uint16_t duration;
+        std::uint8_t midikey;
+        std::uint8_t velocity;
+    };
+    
+    // Slice of the song's notes, patterns with the same notes share one slice
+    struct Pattern {
+        std::uint32_t first;
+        std::uint16_t count;
+    };
+    
+    struct Section {
+        std::uint32_t offset; // ticks from the start of the song
+        std::uint16_t pattern;
+        std::uint16_t instrument;
+    };
+    
+    struct Channel {
+        const Section* sections;
+        std::uint16_t count;
+    };
+    
+    const char* name;
+    std::uint16_t tempo; // beats per minute
+    
+    const Patch* instruments;
+    const Pattern* patterns;
+    const Note* notes;
+    Channel channels[4];
+};
+
+} // namespace FMSynth
@@ -0,0 +1,464 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "Simd.h"
+#include "Voice.h"
+
+namespace FMSynth {
+
+// A fixed set of voices rendered together. Per-sample state (phases, rates, operator gains and
+// feedback) is kept in structure-of-arrays form so that all lanes are evaluated at once using the
+// widest integer SIMD type available (AVX2, SSE2 or scalar fallback). Instead of one function per
+// algorithm every lane carries routing masks describing its algorithm, so voices playing different
+// algorithms still share the same kernel. Control rate values are computed by a regular Voice per
+// lane, so every lane produces exactly the samples Voice::render() would. Lanes are summed at full
+// precision and saturated to 16 bit once per sample, or added unsaturated to a 32 bit bus.
+template<unsigned Samplerate, unsigned Lanes>
+class VoiceBank {
+    
+    public:
+        
+        using Lane = typename Simd::Best<Lanes>::Type;
+        
+        VoiceBank() {
+            for(std::uint32_t l = 0; l < Lanes; ++l) {
+                for(std::uint32_t idx = 0; idx < 4; ++idx) {
+                    _phases_Q32[idx][l] = 0;
+                    _rates_Q32[idx][l] = 0;
+                    _op_gains_Q10[idx][l] = 0;
+                    _carrier_masks[idx][l] = 0;
+                    for(std::uint32_t w = 0; w < 3; ++w) _wave_masks[idx][w][l] = 0;
+                    _blep_dt_Q16[idx][l] = 0;
+                    _blep_scale[idx][l] = 0;
+                }
+                for(std::uint32_t m = 0; m < 6; ++m) _mod_masks[m][l] = 0;
+                _fb_gains_Q10[l] = 0;
+                _feedback_Q15[l] = 0;
+                _master_gains_Q10[l] = 0;
+                _table_masks[l] = 0;
+                _active[l] = false;
+            }
+        }
+        
+        ~VoiceBank() = default;
+        
+        VoiceBank(const VoiceBank&) = delete;
+        VoiceBank& operator =(const VoiceBank&) = delete;
+        
+        static constexpr std::uint32_t size() { return Lanes; }
+        
+        void noteOn(std::uint32_t lane, const Patch& patch, std::int8_t midikey, std::int8_t velocity) {
+            _storeState(lane);
+            _voices[lane].noteOn(patch, midikey, velocity);
+            _loadState(lane);
+        }
+        
+        // Same as noteOn() above from a patch compiled ahead of time, see CompiledPatch
+        void noteOn(std::uint32_t lane, const CompiledPatch<Samplerate>& patch, std::int8_t midikey, std::int8_t velocity) {
+            _storeState(lane);
+            _voices[lane].noteOn(patch, midikey, velocity);
+            _loadState(lane);
+        }
+        
+        inline void noteOff(std::uint32_t lane) { _voices[lane].noteOff(); }
+        
+        // See Voice::reset(), the lane is silent from the next sample on
+        inline void reset(std::uint32_t lane) {
+            _voices[lane].reset();
+            _master_gains_Q10[lane] = 0;
+            _table_masks[lane] = 0;
+            _active[lane] = false;
+        }
+        
+        inline void setPitchBend(std::uint32_t lane, const FixedPoint::Fixed<15>& ratio) { _voices[lane].setPitchBend(ratio); }
+        
+        // See Voice::setSineTable(), takes effect at the lane's next noteOn
+        inline void setSineTable(std::uint32_t lane, bool enabled) { _voices[lane].setSineTable(enabled); }
+        
+        // See Voice::setBandlimited(), takes effect at the lane's next noteOn
+        inline void setBandlimited(std::uint32_t lane, bool enabled) { _voices[lane].setBandlimited(enabled); }
+        
+        inline std::int8_t midikey(std::uint32_t lane) const { return _voices[lane].midikey(); }
+        
+        inline bool released(std::uint32_t lane) const { return _voices[lane].released(); }
+        inline bool finished(std::uint32_t lane) const { return _voices[lane].finished(); }
+        
+        // See Voice::masterGain()
+        inline std::int32_t masterGain(std::uint32_t lane) const { return _voices[lane].masterGain(); }
+        
+        // Renders the mix of all lanes as signed 16 bit samples, overwriting the contents of out
+        inline void render(std::int16_t* out, std::size_t frames) { _render(out, frames, false); }
+        
+        // Same as render() but mixes (saturating add) the block into the existing contents of out
+        inline void renderAdd(std::int16_t* out, std::size_t frames) { _render(out, frames, true); }
+        
+        // Adds the mix of all lanes to a 32 bit bus without saturating, each lane is still clamped to 16 bit
+        // like Voice::render() clamps it. Does nothing while no lane is playing.
+        void renderAdd(std::int32_t* out, std::size_t frames) {
+            std::uint32_t playing = 0;
+            for(std::uint32_t l = 0; l < Lanes; ++l) playing += _active[l];
+            if(playing > _VOICE_LANES) _render(out, frames, true);
+            else if(playing > 0) _renderVoices(out, frames);
+        }
+    
+    private:
+        
+        static constexpr std::uint32_t _CONTROL_PERIOD = Samplerate / Voice<Samplerate>::_CONTROLRATE;
+        
+        // The kernel costs the same for every lane of a group whether it plays or not and evaluates every route,
+        // so with this many lanes playing or fewer the per-algorithm code of Voice is faster
+        static constexpr std::uint32_t _VOICE_LANES = 3;
+        
+        // Hands the per-sample state back to the voice before a noteOn, so glide keeps running phases untouched
+        inline void _storeState(std::uint32_t lane) {
+            Voice<Samplerate>& voice = _voices[lane];
+            for(std::uint32_t idx = 0; idx < 4; ++idx) voice._phase_gens[idx].setPhase(_phases_Q32[idx][lane]);
+            voice._feedback_Q15 = _feedback_Q15[lane];
+        }
+        
+        // Takes over the state the voice set up for its new note
+        inline void _loadState(std::uint32_t lane) {
+            Voice<Samplerate>& voice = _voices[lane];
+            for(std::uint32_t algo_idx = 0; algo_idx < 11; ++algo_idx) {
+                if(voice._cur_algo == Voice<Samplerate>::_algorithms[voice._wave_mask][algo_idx]) {
+                    _setRouting(lane, algo_idx);
+                    _table_masks[lane] = (voice._wave_mask & Voice<Samplerate>::_WAVE_TABLE) ? -1 : 0;
+                    _active[lane] = true;
+                }
+            }
+            
+            for(std::uint32_t idx = 0; idx < 4; ++idx) {
+                for(std::uint32_t w = 0; w < 3; ++w) _wave_masks[idx][w][lane] = voice._wave_masks[idx][w];
+            }
+            
+            for(std::uint32_t idx = 0; idx < 4; ++idx) _phases_Q32[idx][lane] = voice._phase_gens[idx].phase();
+            _feedback_Q15[lane] = voice._feedback_Q15;
+            _loadControlValues(lane);
+        }
+        
+        // Modulation routes (destination <- source) and carrier bits for each algorithm
+        enum Route: std::uint8_t { M3_4 = 1, M2_4 = 2, M2_3 = 4, M1_4 = 8, M1_3 = 16, M1_2 = 32 };
+        enum Carrier: std::uint8_t { C1 = 1, C2 = 2, C3 = 4, C4 = 8 };
+        
+        static constexpr std::uint8_t _ROUTES[11] = {
+            M3_4 | M2_3 | M1_2,
+            M2_3 | M2_4 | M1_2,
+            M2_3 | M1_2 | M1_4,
+            M3_4 | M2_4 | M1_2 | M1_3,
+            M3_4 | M2_3 | M1_3,
+            M3_4 | M2_3,
+            M1_2 | M1_3 | M1_4,
+            M3_4 | M1_2,
+            M1_4 | M2_4 | M3_4,
+            M3_4,
+            0
+        };
+        
+        static constexpr std::uint8_t _CARRIERS[11] = {
+            C1, C1, C1, C1, C1 | C2, C1 | C2, C1, C1 | C3, C1 | C2 | C3, C1 | C2 | C3, C1 | C2 | C3 | C4
+        };
+        
+        inline void _setRouting(std::uint32_t lane, std::uint32_t algo_idx) {
+            for(std::uint32_t m = 0; m < 6; ++m) _mod_masks[m][lane] = (_ROUTES[algo_idx] & (1 << m)) ? -1 : 0;
+            for(std::uint32_t idx = 0; idx < 4; ++idx) _carrier_masks[idx][lane] = (_CARRIERS[algo_idx] & (1 << idx)) ? -1 : 0;
+        }
+        
+        inline void _loadControlValues(std::uint32_t lane) {
+            Voice<Samplerate>& voice = _voices[lane];
+            for(std::uint32_t idx = 0; idx < 4; ++idx) {
+                _rates_Q32[idx][lane] = voice._phase_gens[idx].rate();
+                _op_gains_Q10[idx][lane] = voice._op_gains_Q10[idx];
+                _blep_dt_Q16[idx][lane] = voice._blep_dt_Q16[idx];
+                _blep_scale[idx][lane] = voice._blep_scale[idx];
+            }
+            _fb_gains_Q10[lane] = voice._fb_gain_Q10;
+            _master_gains_Q10[lane] = voice._master_gain_Q10;
+        }
+        
+        template<typename Sample>
+        void _render(Sample* out, std::size_t frames, bool add) {
+            alignas(32) std::int32_t mix[_CONTROL_PERIOD];
+            
+            while(frames > 0) {
+                std::size_t run = frames < _CONTROL_PERIOD ? frames : _CONTROL_PERIOD;
+                bool went_idle[Lanes];
+                bool any_idle = false;
+                
+                // Advance control ticks of every lane, the block is split at the earliest control update
+                for(std::uint32_t l = 0; l < Lanes; ++l) {
+                    went_idle[l] = false;
+                    if(!_active[l]) continue;
+                    
+                    Voice<Samplerate>& voice = _voices[l];
+                    ++voice._control_ticks;
+                    if(voice._control_ticks >= _CONTROL_PERIOD) {
+                        voice._control_ticks = 0;
+                        
+                        voice._updateControlValues();
+                        _loadControlValues(l);
+                        
+                        if(voice._master_env_gen.stage() >= EnvelopeGenerator::Stage::Idle) {
+                            went_idle[l] = true;
+                            any_idle = true;
+                        }
+                    }
+                    
+                    std::size_t remaining = _CONTROL_PERIOD - voice._control_ticks;
+                    if(remaining < run) run = remaining;
+                }
+                if(any_idle) run = 1;
+                
+                for(std::uint32_t l = 0; l < Lanes; ++l) {
+                    if(_active[l]) _voices[l]._control_ticks += run - 1;
+                }
+                
+                for(std::size_t i = 0; i < run; ++i) mix[i] = 0;
+                
+                for(std::uint32_t l = 0; l < Lanes; l += Lane::Width) {
+                    bool any_active = false;
+                    bool any_table = false;
+                    bool any_waves = false;
+                    bool any_blep = false;
+                    for(std::uint32_t k = 0; k < Lane::Width; ++k) {
+                        any_active |= _active[l + k];
+                        any_table |= _active[l + k] && _table_masks[l + k];
+                        any_waves |= _active[l + k] && (_voices[l + k]._wave_mask & Voice<Samplerate>::_WAVE_SHAPES);
+                        any_blep |= _active[l + k] && (_voices[l + k]._wave_mask & Voice<Samplerate>::_WAVE_BLEP);
+                    }
+                    if(any_active) {
+                        // Only kernels for the sine oscillators Voice compiles are instantiated (see
+                        // FMSYNTH_SINE_TABLE), with just one of them both branches take the same kernels
+                        if(Voice<Samplerate>::_HAS_SINE_TABLE && any_table) _kernels<Voice<Samplerate>::_HAS_SINE_TABLE>(l, mix, run, any_waves, any_blep);
+                        else _kernels<!Voice<Samplerate>::_HAS_SINE_APPROX>(l, mix, run, any_waves, any_blep);
+                    }
+                }
+                
+                for(std::uint32_t l = 0; l < Lanes; ++l) {
+                    if(went_idle[l]) {
+                        _voices[l]._cur_algo = Voice<Samplerate>::_null_algorithm;
+                        _voices[l]._cur_block = Voice<Samplerate>::_null_block;
+                        _master_gains_Q10[l] = 0;
+                        _table_masks[l] = 0;
+                        _active[l] = false;
+                    }
+                }
+                
+                _output(out, mix, run, add);
+                
+                out += run;
+                frames -= run;
+            }
+        }
+        
+        // Renders the playing lanes one at a time through their own Voice. Phases and feedback move to the voice
+        // and back, everything else the voice keeps up to date anyway, so the lanes go on exactly where the
+        // voices stopped whichever way the next block is rendered.
+        void _renderVoices(std::int32_t* out, std::size_t frames) {
+            constexpr std::size_t BLOCK = 256;
+            std::int16_t block[BLOCK];
+            
+            for(std::uint32_t l = 0; l < Lanes; ++l) {
+                if(!_active[l]) continue;
+                
+                Voice<Samplerate>& voice = _voices[l];
+                _storeState(l);
+                for(std::size_t offset = 0; offset < frames; offset += BLOCK) {
+                    std::size_t run = frames - offset < BLOCK ? frames - offset : BLOCK;
+                    std::size_t rendered = voice.render(block, run);
+                    for(std::size_t i = 0; i < rendered; ++i) out[offset + i] += block[i];
+                    if(rendered < run) break;
+                }
+                
+                for(std::uint32_t idx = 0; idx < 4; ++idx) _phases_Q32[idx][l] = voice._phase_gens[idx].phase();
+                _feedback_Q15[l] = voice._feedback_Q15;
+                _loadControlValues(l);
+                if(voice._cur_algo == Voice<Samplerate>::_null_algorithm) {
+                    _master_gains_Q10[l] = 0;
+                    _table_masks[l] = 0;
+                    _active[l] = false;
+                }
+            }
+        }
+        
+        static inline void _output(std::int16_t* out, const std::int32_t* mix, std::size_t run, bool add) {
+            for(std::size_t i = 0; i < run; ++i) {
+                std::int32_t value = add ? out[i] + mix[i] : mix[i];
+                out[i] = value > 32767 ? 32767 : (value < -32768 ? -32768 : value);
+            }
+        }
+        
+        static inline void _output(std::int32_t* out, const std::int32_t* mix, std::size_t run, bool) {
+            for(std::size_t i = 0; i < run; ++i) out[i] += mix[i];
+        }
+        
+        static inline Lane _sin(Lane phase_Q15) {
+            Lane p = phase_Q15 & Lane::set1(16383);
+            Lane a = Lane::select((phase_Q15 & Lane::set1(16384)).isZero(), Lane::set1(16384) - p, p - Lane::set1(16384));
+            return Simd::divPow2<11>(a * p);
+        }
+        
+        // Same as Voice::_sqr, _saw and _tri, the lane's wave masks pick one of them (or none)
+        static inline Lane _wave(Lane phase_Q15, Lane sqr, Lane saw, Lane tri) {
+            Lane first_half = (phase_Q15 & Lane::set1(16384)).isZero();
+            Lane square = Lane::select(first_half, Lane::set1(32768), Lane::set1(-32768));
+            Lane p = phase_Q15 & Lane::set1(32767);
+            Lane sawtooth = p + p - Lane::set1(32767);
+            Lane q = (phase_Q15 & Lane::set1(16383)).template sll<2>();
+            Lane triangle = Lane::select(first_half, q - Lane::set1(32768), Lane::set1(32767) - q);
+            return (sqr & square) + (saw & sawtooth) + (tri & triangle);
+        }
+        
+        // Same as Voice::_blep, lanes with dt_Q16 = 0 get no correction
+        static inline Lane _blep(Lane t_Q16, Lane dt_Q16, Lane scale) {
+            Lane s_Q16 = Lane::set1(65536) - t_Q16;
+            Lane lead = (t_Q16 - dt_Q16).isNegative();
+            Lane trail = (s_Q16 - dt_Q16).isNegative();
+            Lane a = Lane::set1(32768) - (Lane::select(lead, t_Q16, s_Q16) * scale).template sra<15>();
+            Lane d = (a * a).template sra<15>();
+            return (trail & d) - (lead & d);
+        }
+        
+        // Operator oscillator matching Voice::_osc, phase_Q32 is the modulated phase. Lanes with table set use
+        // the interpolated sine table, there is no integer gather before AVX2 so the lookups are done per lane
+        // and only when some lane needs them. Waves enables the square, saw and triangle masks (masks[0-2]),
+        // Blep adds the PolyBLEP correction to square and saw. Without the approximation compiled (see
+        // FMSYNTH_SINE_TABLE) every lane uses the table.
+        template<bool Table, bool Waves, bool Blep>
+        static inline Lane _osc(Lane phase_Q32, Lane table, const Lane (&masks)[3], Lane dt_Q16, Lane scale) {
+            Lane phase_Q15 = phase_Q32.template srl<32 - 15>();
+            Lane out = Voice<Samplerate>::_HAS_SINE_APPROX ? _sin(phase_Q15) : Lane::set1(0);
+            
+            if(Table) {
+                alignas(32) std::int32_t values[Lane::Width];
+                phase_Q15.store(values);
+                for(std::uint32_t k = 0; k < Lane::Width; ++k) values[k] = FMSynth::sineTable(values[k]);
+                out = Voice<Samplerate>::_HAS_SINE_APPROX ? Lane::select(table, Lane::load(values), out) : Lane::load(values);
+            }
+            
+            if(Waves) {
+                Lane wave = masks[0] + masks[1] + masks[2];
+                Lane shaped = _wave(phase_Q15, masks[0], masks[1], masks[2]);
+                if(Blep) {
+                    Lane t_Q16 = phase_Q32.template srl<32 - 16>();
+                    Lane rising = _blep(t_Q16, dt_Q16, scale);
+                    Lane falling = _blep((t_Q16 + Lane::set1(32768)) & Lane::set1(65535), dt_Q16, scale);
+                    shaped = shaped + (masks[0] & (rising - falling)) - (masks[1] & rising);
+                }
+                out = Lane::select(wave, shaped, out);
+            }
+            
+            return out;
+        }
+        
+        // Scales operator output by op_gain for carriers or by 2.25*op_gain for modulators
+        static inline Lane _scale(Lane out, Lane gain_Q10, Lane carrier) {
+            return Lane::select(carrier, Simd::divPow2<10>(out * gain_Q10), Simd::divPow2<10 + 2>(out * Lane::set1(9) * gain_Q10));
+        }
+        
+        // Picks the _kernel variant for the waveforms the lanes play
+        template<bool Table>
+        inline void _kernels(std::uint32_t first, std::int32_t* mix, std::size_t run, bool waves, bool blep) {
+            if(blep) _kernel<Table, true, true>(first, mix, run);
+            else if(waves) _kernel<Table, true, false>(first, mix, run);
+            else _kernel<Table, false, false>(first, mix, run);
+        }
+        
+        // Renders run samples of lanes [first, first + Lane::Width) and adds their clamped outputs to mix
+        template<bool Table, bool Waves, bool Blep>
+        inline void _kernel(std::uint32_t first, std::int32_t* mix, std::size_t run) {
+            Lane phase1 = Lane::load(&_phases_Q32[0][first]);
+            Lane phase2 = Lane::load(&_phases_Q32[1][first]);
+            Lane phase3 = Lane::load(&_phases_Q32[2][first]);
+            Lane phase4 = Lane::load(&_phases_Q32[3][first]);
+            const Lane rate1 = Lane::load(&_rates_Q32[0][first]);
+            const Lane rate2 = Lane::load(&_rates_Q32[1][first]);
+            const Lane rate3 = Lane::load(&_rates_Q32[2][first]);
+            const Lane rate4 = Lane::load(&_rates_Q32[3][first]);
+            const Lane gain1 = Lane::load(&_op_gains_Q10[0][first]);
+            const Lane gain2 = Lane::load(&_op_gains_Q10[1][first]);
+            const Lane gain3 = Lane::load(&_op_gains_Q10[2][first]);
+            const Lane gain4 = Lane::load(&_op_gains_Q10[3][first]);
+            const Lane carrier2 = Lane::load(&_carrier_masks[1][first]);
+            const Lane carrier3 = Lane::load(&_carrier_masks[2][first]);
+            const Lane carrier4 = Lane::load(&_carrier_masks[3][first]);
+            const Lane m3_4 = Lane::load(&_mod_masks[0][first]);
+            const Lane m2_4 = Lane::load(&_mod_masks[1][first]);
+            const Lane m2_3 = Lane::load(&_mod_masks[2][first]);
+            const Lane m1_4 = Lane::load(&_mod_masks[3][first]);
+            const Lane m1_3 = Lane::load(&_mod_masks[4][first]);
+            const Lane m1_2 = Lane::load(&_mod_masks[5][first]);
+            const Lane fb_gain = Lane::load(&_fb_gains_Q10[first]);
+            const Lane fb_square = fb_gain.isNegative();
+            const Lane master_gain = Lane::load(&_master_gains_Q10[first]);
+            const Lane table = Lane::load(&_table_masks[first]);
+            Lane waves[4][3];
+            for(std::uint32_t idx = 0; idx < 4; ++idx) {
+                for(std::uint32_t w = 0; w < 3; ++w) waves[idx][w] = Waves ? Lane::load(&_wave_masks[idx][w][first]) : Lane::set1(0);
+            }
+            Lane blep_dt[4];
+            Lane blep_scale[4];
+            for(std::uint32_t idx = 0; idx < 4; ++idx) {
+                blep_dt[idx] = Blep ? Lane::load(&_blep_dt_Q16[idx][first]) : Lane::set1(0);
+                blep_scale[idx] = Blep ? Lane::load(&_blep_scale[idx][first]) : Lane::set1(0);
+            }
+            Lane feedback = Lane::load(&_feedback_Q15[first]);
+            
+            for(std::size_t i = 0; i < run; ++i) {
+                // Same operations as PhaseGenerator::tick(pm) followed by Voice::_process
+                phase4 = phase4 + rate4;
+                Lane out4 = _osc<Table, Waves, Blep>(phase4 + feedback.template sll<32 - 15>(), table, waves[3], blep_dt[3], blep_scale[3]);
+                feedback = Simd::divPow2<10 + 2>(Lane::select(fb_square, (out4 * out4).template sra<15>(), out4) * Lane::set1(9) * fb_gain);
+                out4 = _scale(out4, gain4, carrier4);
+                
+                phase3 = phase3 + rate3;
+                Lane out3 = _osc<Table, Waves, Blep>(phase3 + (m3_4 & out4).template sll<32 - 15>(), table, waves[2], blep_dt[2], blep_scale[2]);
+                out3 = _scale(out3, gain3, carrier3);
+                
+                phase2 = phase2 + rate2;
+                Lane out2 = _osc<Table, Waves, Blep>(phase2 + ((m2_4 & out4) + (m2_3 & out3)).template sll<32 - 15>(), table, waves[1], blep_dt[1], blep_scale[1]);
+                out2 = _scale(out2, gain2, carrier2);
+                
+                phase1 = phase1 + rate1;
+                Lane out1 = _osc<Table, Waves, Blep>(phase1 + ((m1_4 & out4) + (m1_3 & out3) + (m1_2 & out2)).template sll<32 - 15>(), table, waves[0], blep_dt[0], blep_scale[0]);
+                out1 = Simd::divPow2<10>(out1 * gain1);
+                
+                Lane out = out1 + (carrier2 & out2) + (carrier3 & out3) + (carrier4 & out4);
+                mix[i] += Simd::divPow2<10>(out * master_gain).clamp16().sum();
+            }
+            
+            phase1.store(&_phases_Q32[0][first]);
+            phase2.store(&_phases_Q32[1][first]);
+            phase3.store(&_phases_Q32[2][first]);
+            phase4.store(&_phases_Q32[3][first]);
+            feedback.store(&_feedback_Q15[first]);
+        }
+        
+        Voice<Samplerate> _voices[Lanes];
+        
+        alignas(32) std::uint32_t _phases_Q32[4][Lanes];
+        alignas(32) std::uint32_t _rates_Q32[4][Lanes];
+        alignas(32) std::int32_t _op_gains_Q10[4][Lanes];
+        
+        // Routing masks, all bits set when the route is used by the lane's algorithm
+        alignas(32) std::int32_t _mod_masks[6][Lanes];
+        alignas(32) std::int32_t _carrier_masks[4][Lanes];
+        
+        // All bits set when the lane's voice uses the sine table
+        alignas(32) std::int32_t _table_masks[Lanes];
+        
+        // Copies of Voice::_wave_masks, [operator][square, saw, triangle][lane]
+        alignas(32) std::int32_t _wave_masks[4][3][Lanes];
+        
+        // Copies of Voice::_blep_dt_Q16 and Voice::_blep_scale, zero for lanes without band-limiting
+        alignas(32) std::int32_t _blep_dt_Q16[4][Lanes];
+        alignas(32) std::int32_t _blep_scale[4][Lanes];
+        
+        alignas(32) std::int32_t _fb_gains_Q10[Lanes];
+        alignas(32) std::int32_t _feedback_Q15[Lanes];
+        alignas(32) std::int32_t _master_gains_Q10[Lanes];
+        
+        bool _active[Lanes];
+};
+
+} // namespace FMSynth
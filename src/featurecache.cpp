@@ -0,0 +1,112 @@
+/**********************************************************************************
+ * MIT License                                                                    *
+ *                                                                                *
+ * Copyright (c) 2023 Justin (tuxinator2009) Davis                                *
+ *                                                                                *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy   *
+ * of this software and associated documentation files (the "Software"), to deal  *
+ * in the Software without restriction, including without limitation the rights   *
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+ * copies of the Software, and to permit persons to whom the Software is          *
+ * furnished to do so, subject to the following conditions:                       *
+ *                                                                                *
+ * The above copyright notice and this permission notice shall be included in all *
+ * copies or substantial portions of the Software.                                *
+ *                                                                                *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+ * SOFTWARE.                                                                      *
+ **********************************************************************************/
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include "featurecache.h"
+#include "globals.h"
+
+QCache<QByteArray, WaveformAnalyzer::Features> FeatureCache::cache(CACHE_SIZE);
+
+void FeatureCache::analyze(const uint8_t samples[WaveformAnalyzer::sampleRate], WaveformAnalyzer::Features *features)
+{
+  QByteArray key = hashKey(samples);
+  WaveformAnalyzer::Features *cached = cache.object(key);
+  if (cached != nullptr)
+  {
+    *features = *cached;
+    return;
+  }
+  //The waveform is cheaper to convert again than to read back, it isn't stored in the file
+  if (readFile(filePath(key), features))
+    WaveformAnalyzer::loadSamples(samples, features->waveform);
+  else
+  {
+    WaveformAnalyzer::analyzeFeatures(samples, features);
+    writeFile(filePath(key), *features);
+  }
+  //QCache takes ownership
+  cache.insert(key, new WaveformAnalyzer::Features(*features));
+}
+
+QString FeatureCache::filePath(const uint8_t samples[WaveformAnalyzer::sampleRate])
+{
+  return filePath(hashKey(samples));
+}
+
+QByteArray FeatureCache::hashKey(const uint8_t samples[WaveformAnalyzer::sampleRate])
+{
+  return QCryptographicHash::hash(QByteArray::fromRawData((const char*)samples, WaveformAnalyzer::sampleRate), QCryptographicHash::Sha1).toHex();
+}
+
+QString FeatureCache::filePath(const QByteArray &key)
+{
+  return Globals::homePath + "/features/" + QString::fromLatin1(key) + ".dat";
+}
+
+bool FeatureCache::readFile(const QString &location, WaveformAnalyzer::Features *features)
+{
+  QFile file(location);
+  QDataStream stream(&file);
+  quint32 magic;
+  quint32 version;
+  if (!file.open(QFile::ReadOnly))
+    return false;
+  stream.setVersion(QDataStream::Qt_5_0);
+  stream >> magic >> version;
+  if (magic != FILE_MAGIC || version != FILE_VERSION)
+    return false;
+  for (int i = 0; i < WaveformAnalyzer::numFrequencies; ++i)
+    stream >> features->spectrum[i];
+  for (int i = 0; i < WaveformAnalyzer::numCoefficients; ++i)
+    stream >> features->mfccs[i];
+  for (int i = 0; i < WaveformAnalyzer::numWindows; ++i)
+    stream >> features->windowAverage[i] >> features->windowMax[i];
+  return stream.status() == QDataStream::Ok && stream.atEnd();
+}
+
+//Failing to write is not an error, the features just get computed again next time
+void FeatureCache::writeFile(const QString &location, const WaveformAnalyzer::Features &features)
+{
+  QSaveFile file(location);
+  QDataStream stream(&file);
+  QDir(Globals::homePath).mkpath("features");
+  if (!file.open(QFile::WriteOnly))
+  {
+    printf("Error: failed to save reference features\nReason: %s\n", file.errorString().toLocal8Bit().data());
+    return;
+  }
+  stream.setVersion(QDataStream::Qt_5_0);
+  stream << FILE_MAGIC << FILE_VERSION;
+  for (int i = 0; i < WaveformAnalyzer::numFrequencies; ++i)
+    stream << features.spectrum[i];
+  for (int i = 0; i < WaveformAnalyzer::numCoefficients; ++i)
+    stream << features.mfccs[i];
+  for (int i = 0; i < WaveformAnalyzer::numWindows; ++i)
+    stream << features.windowAverage[i] << features.windowMax[i];
+  file.commit();
+}
@@ -0,0 +1,56 @@
+/**********************************************************************************
+ * MIT License                                                                    *
+ *                                                                                *
+ * Copyright (c) 2023 Justin (tuxinator2009) Davis                                *
+ *                                                                                *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy   *
+ * of this software and associated documentation files (the "Software"), to deal  *
+ * in the Software without restriction, including without limitation the rights   *
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+ * copies of the Software, and to permit persons to whom the Software is          *
+ * furnished to do so, subject to the following conditions:                       *
+ *                                                                                *
+ * The above copyright notice and this permission notice shall be included in all *
+ * copies or substantial portions of the Software.                                *
+ *                                                                                *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+ * SOFTWARE.                                                                      *
+ **********************************************************************************/
+
+#ifndef FEATURECACHE_H
+#define FEATURECACHE_H
+
+#include <QByteArray>
+#include <QCache>
+#include <QString>
+#include "waveformanalyzer.h"
+
+//Memoizes the analysis of reference samples, which never change once they are loaded. Features are found by
+//a hash of the samples, first in memory and then in ~/.fmstudio/features, so reopening a reference (even in
+//a later session) skips the FFT and MFCCs. Only used from the GUI thread.
+class FeatureCache
+{
+  public:
+    //Fills features for one second of 8-bit samples, analyzing them only if they were never seen before
+    static void analyze(const uint8_t samples[WaveformAnalyzer::sampleRate], WaveformAnalyzer::Features *features);
+    //File the features of the samples are kept in. readFile fails on a file of another version or one that is
+    //cut short, analyze() then computes the features again and rewrites it. The waveform isn't stored.
+    static QString filePath(const uint8_t samples[WaveformAnalyzer::sampleRate]);
+    static bool readFile(const QString &location, WaveformAnalyzer::Features *features);
+    static void writeFile(const QString &location, const WaveformAnalyzer::Features &features);
+  private:
+    static constexpr int CACHE_SIZE = 16;
+    static constexpr quint32 FILE_MAGIC = 0x464D4643;//"FMFC"
+    //Must change whenever the analysis does so files written by older versions get recomputed
+    static constexpr quint32 FILE_VERSION = 1;
+    static QByteArray hashKey(const uint8_t samples[WaveformAnalyzer::sampleRate]);
+    static QString filePath(const QByteArray &key);
+    static QCache<QByteArray, WaveformAnalyzer::Features> cache;
+};
+
+#endif //FEATURECACHE_H
@@ -0,0 +1,204 @@
+/**********************************************************************************
+ * MIT License                                                                    *
+ *                                                                                *
+ * Copyright (c) 2023 Justin (tuxinator2009) Davis                                *
+ *                                                                                *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy   *
+ * of this software and associated documentation files (the "Software"), to deal  *
+ * in the Software without restriction, including without limitation the rights   *
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+ * copies of the Software, and to permit persons to whom the Software is          *
+ * furnished to do so, subject to the following conditions:                       *
+ *                                                                                *
+ * The above copyright notice and this permission notice shall be included in all *
+ * copies or substantial portions of the Software.                                *
+ *                                                                                *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+ * SOFTWARE.                                                                      *
+ **********************************************************************************/
+
+
+#include <cstring>
+#include "fmplayer.h"
+
+FMPlayer::FMPlayer(int numChannels, unsigned samplerate, FMSource::SampleFormat format, int polyphony) : _source(numChannels, samplerate, format, polyphony)
+{
+  open(QIODevice::ReadOnly);
+  _sampleSize = FMSource::bytesPerSample(format);
+  _tempo = 120;
+  _latency = _source.getSamplerate() * LATENCY_MS / 1000 * _sampleSize;
+  _pending = 0;
+  _idle = true;
+  _quit = false;
+  _thread = new RenderThread(this);
+  _thread->start(QThread::TimeCriticalPriority);
+}
+
+FMPlayer::~FMPlayer()
+{
+  Command command;
+  _quit = true;
+  _thread->wait();
+  delete _thread;
+  while (_commands.pop(command))
+    delete command.score;
+  close();
+}
+
+void FMPlayer::setTempo(uint32_t tempo)
+{
+  Command command;
+  command.type = Command::Type::SetTempo;
+  command.tempo = tempo;
+  _tempo = tempo;
+  sendCommand(command);
+}
+
+void FMPlayer::playSong(FMSong *song)
+{
+  Command command;
+  command.type = Command::Type::Play;
+  command.score = FMSource::compileSong(song, _source.getSamplerate(), _tempo);
+  sendCommand(command);
+}
+
+void FMPlayer::stopSong()
+{
+  Command command;
+  command.type = Command::Type::StopSong;
+  sendCommand(command);
+}
+
+void FMPlayer::playPattern(int channel, const QList<FMSong::Note> &notes, const FMSynth::Patch &patch)
+{
+  Command command;
+  command.type = Command::Type::Play;
+  command.score = FMSource::compilePattern(channel, notes, patch, _source.getSamplerate(), _tempo);
+  sendCommand(command);
+}
+
+void FMPlayer::stopPattern(int channel)
+{
+  Command command;
+  command.type = Command::Type::StopPattern;
+  command.channel = channel;
+  sendCommand(command);
+}
+
+void FMPlayer::noteOn(int channel, const FMSynth::Patch &patch, uint8_t note, int duration, uint8_t velocity)
+{
+  Command command;
+  command.type = Command::Type::NoteOn;
+  command.channel = channel;
+  command.patch = patch;
+  command.note = note;
+  command.duration = duration;
+  command.velocity = velocity;
+  sendCommand(command);
+}
+
+bool FMPlayer::atEnd() const
+{
+  return _pending == 0 && _idle && _buffer.empty();
+}
+
+void FMPlayer::noteOff(int channel)
+{
+  Command command;
+  command.type = Command::Type::NoteOff;
+  command.channel = channel;
+  sendCommand(command);
+}
+
+//Called from the audio device, only ever copies out what the render thread has prepared
+qint64 FMPlayer::readData(char *data, qint64 maxSize)
+{
+  qint64 length = _buffer.read((uint8_t*)data, maxSize);
+  if (length == 0)
+  {
+    //Render thread fell behind, keep the device fed with silence instead of letting it go idle
+    length = maxSize / _sampleSize;
+    if (length > CHUNK_SIZE)
+      length = CHUNK_SIZE;
+    FMSource::silence(data, length, _source.getFormat());
+    length *= _sampleSize;
+  }
+  return length;
+}
+
+qint64 FMPlayer::writeData(const char *data, qint64 maxSize)
+{
+  Q_UNUSED(data);
+  Q_UNUSED(maxSize);
+  return 0;
+}
+
+void FMPlayer::sendCommand(const Command &command)
+{
+  ++_pending;
+  while (!_commands.push(command))
+    QThread::yieldCurrentThread();
+}
+
+void FMPlayer::processCommands()
+{
+  Command command;
+  int processed = 0;
+  while (_commands.pop(command))
+  {
+    switch (command.type)
+    {
+      case Command::Type::SetTempo:
+        _source.setTempo(command.tempo);
+        break;
+      case Command::Type::Play:
+        _source.play(command.score);
+        break;
+      case Command::Type::StopSong:
+        _source.stopSong();
+        _buffer.discard();
+        break;
+      case Command::Type::StopPattern:
+        _source.stopPattern(command.channel);
+        _buffer.discard();
+        break;
+      case Command::Type::NoteOn:
+        _source.noteOn(command.channel, command.patch, command.note, command.duration, command.velocity);
+        break;
+      case Command::Type::NoteOff:
+        _source.noteOff(command.channel);
+        break;
+    }
+    ++processed;
+  }
+  if (processed > 0)
+  {
+    _idle = _source.atEnd();
+    _pending -= processed;
+  }
+}
+
+//Keeps up to LATENCY_MS of audio rendered ahead of the audio device. Commands are picked up between chunks
+//so a key press is heard at most one chunk plus the buffered audio later.
+void FMPlayer::renderLoop()
+{
+  uint8_t chunk[CHUNK_SIZE * sizeof(float)];
+  size_t chunkSize = CHUNK_SIZE * _sampleSize;
+  while (!_quit)
+  {
+    processCommands();
+    if (_buffer.size() + chunkSize <= _latency)
+    {
+      _source.render(chunk, CHUNK_SIZE);
+      _buffer.write(chunk, chunkSize);
+      _idle = _source.atEnd();
+    }
+    else
+      QThread::usleep(1000);
+  }
+}
@@ -0,0 +1,96 @@
+/**********************************************************************************
+ * MIT License                                                                    *
+ *                                                                                *
+ * Copyright (c) 2023 Justin (tuxinator2009) Davis                                *
+ *                                                                                *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy   *
+ * of this software and associated documentation files (the "Software"), to deal  *
+ * in the Software without restriction, including without limitation the rights   *
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+ * copies of the Software, and to permit persons to whom the Software is          *
+ * furnished to do so, subject to the following conditions:                       *
+ *                                                                                *
+ * The above copyright notice and this permission notice shall be included in all *
+ * copies or substantial portions of the Software.                                *
+ *                                                                                *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+ * SOFTWARE.                                                                      *
+ **********************************************************************************/
+
+
+#ifndef FMPLAYER_H
+#define FMPLAYER_H
+
+#include <atomic>
+#include <QIODevice>
+#include <QThread>
+#include "FMSource.h"
+#include "spscqueue.h"
+
+//Real-time playback device for QAudioOutput. The synth runs on its own render thread which owns the
+//FMSource exclusively: the UI only posts commands through a lock-free queue and the audio device only
+//copies already rendered samples out of a lock-free ring buffer, so neither can stall or race the other.
+//Songs and patterns are compiled into a FMSource::Score on the UI thread before they are posted, the render
+//thread never reads the songs and instruments the editor keeps changing.
+class FMPlayer : public QIODevice
+{
+  public:
+    FMPlayer(int numChannels, unsigned samplerate=8000, FMSource::SampleFormat format=FMSource::SampleFormat::UInt8, int polyphony=FMSource::DEFAULT_POLYPHONY);
+    ~FMPlayer();
+    void setTempo(uint32_t tempo);
+    void playSong(FMSong *song);
+    void stopSong();
+    void playPattern(int channel, const QList<FMSong::Note> &notes, const FMSynth::Patch &patch);
+    void stopPattern(int channel);
+    void noteOn(int channel, const FMSynth::Patch &patch, uint8_t note, int duration, uint8_t velocity=127);
+    bool atEnd() const override;
+  public slots:
+    void noteOff(int channel);
+  protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 maxSize) override;
+  private:
+    struct Command
+    {
+      enum class Type {SetTempo, Play, StopSong, StopPattern, NoteOn, NoteOff};
+      Type type;
+      int channel;
+      int duration;
+      uint32_t tempo;
+      uint8_t note;
+      uint8_t velocity;
+      FMSource::Score *score = nullptr;
+      FMSynth::Patch patch;
+    };
+    class RenderThread : public QThread
+    {
+      public:
+        RenderThread(FMPlayer *player) : player(player) {}
+      protected:
+        void run() override {player->renderLoop();}
+      private:
+        FMPlayer *player;
+    };
+    static constexpr int CHUNK_SIZE = 64;
+    static constexpr int LATENCY_MS = 64;
+    void sendCommand(const Command &command);
+    void processCommands();
+    void renderLoop();
+    FMSource _source;
+    SPSCQueue<Command, 256> _commands;
+    SPSCQueue<uint8_t, 16384> _buffer;
+    size_t _latency;
+    int _sampleSize;
+    uint32_t _tempo; //UI thread side, the tempo scores are compiled with
+    RenderThread *_thread;
+    std::atomic<int> _pending;
+    std::atomic<bool> _idle;
+    std::atomic<bool> _quit;
+};
+
+#endif //FMPLAYER_H
@@ -22,18 +22,31 @@
  * SOFTWARE.                                                                      *
  **********************************************************************************/
 
+#include <cstdio>
 #include <QFile>
-#include <QFileDialog>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QList>
-#include <QMessageBox>
 #include <QString>
+#ifndef FMSTUDIO_CLI
+#include <QFileDialog>
+#include <QMessageBox>
+#endif
 #include "fmproject.h"
 #include "fmsong.h"
 #include "globals.h"
 
+//The command line exporter is built without Qt Widgets so errors are printed instead of shown in a dialog
+static void showError(QString title, QString message)
+{
+#ifdef FMSTUDIO_CLI
+  fprintf(stderr, "%s: %s\n", title.toLocal8Bit().data(), message.toLocal8Bit().data());
+#else
+  QMessageBox::critical(nullptr, title, message);
+#endif
+}
+
 FMProject::FMProject()
 {
   name = "Untitled";
@@ -53,7 +66,7 @@ FMProject::FMProject(QString fileLocation)
   QJsonParseError error;
   if (!file.open(QFile::ReadOnly))
   {
-    QMessageBox::critical(nullptr, "File Error", QString("Failed to open file: \"%1\"\nReason: %2").arg(fileLocation).arg(file.errorString()));
+    showError("File Error", QString("Failed to open file: \"%1\"\nReason: %2").arg(fileLocation).arg(file.errorString()));
     saved = false;
     return;
   }
@@ -61,7 +74,7 @@ FMProject::FMProject(QString fileLocation)
   file.close();
   if (error.error != QJsonParseError::NoError)
   {
-    QMessageBox::critical(nullptr, "JSON Error", QString("Failed to parse json file: \"%1\"\nReason: %2").arg(fileLocation).arg(error.errorString()));
+    showError("JSON Error", QString("Failed to parse json file: \"%1\"\nReason: %2").arg(fileLocation).arg(error.errorString()));
     saved = false;
     return;
   }
@@ -85,7 +98,11 @@ void FMProject::saveProject(QString fileLocation)
     saveLocation = fileLocation;
   else if (location.isEmpty())
   {
+#ifdef FMSTUDIO_CLI
+    return;
+#else
     location = QFileDialog::getSaveFileName(nullptr, "Save Project", location, "FM Studio Project (*.fmx)");
+#endif
     if (location.isEmpty())
       return;
     saveLocation = location;
@@ -116,7 +133,7 @@ void FMProject::saveProject(QString fileLocation)
   data["songs"] = array;
   if (!file.open(QFile::WriteOnly))
   {
-    QMessageBox::critical(nullptr, "File Error", QString("Failed to open file: \"%1\"\nReason: %2").arg(location).arg(file.errorString()));
+    showError("File Error", QString("Failed to open file: \"%1\"\nReason: %2").arg(location).arg(file.errorString()));
     return;
   }
   json.setObject(data);
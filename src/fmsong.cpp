@@ -22,15 +22,109 @@
  * SOFTWARE.                                                                      *
  **********************************************************************************/
 
+#include <QFile>
 #include <QJsonArray>
 #include <QJsonObject>
 #include <QJsonValue>
+#include <QMap>
+#include <QRegularExpression>
 #include "CHeaderParser/cheaderparser.h"
+#include "FMSynth/Voice.h"
 #include "fmproject.h"
 #include "fmsong.h"
 #include "globals.h"
 #include "undo.h"
 
+static QString escapeString(QString text)
+{
+  return text.replace("\\", "\\\\").replace("\"", "\\\"");
+}
+
+static QString patchInitializer(const FMSynth::Patch &patch)
+{
+  QString text;
+  text += "    {\n";
+  text += QString("      .name=\"%1\",\n").arg(escapeString(QString::fromLatin1(patch.name, strnlen(patch.name, sizeof(patch.name)))));
+  text += QString("      .algorithm=%1, .volume=%2, .feedback=%3, .glide=%4, .attack=%5, .decay=%6, .sustain=%7, .release=%8,\n").arg(patch.algorithm).arg(patch.volume).arg(patch.feedback).arg(patch.glide).arg(patch.attack).arg(patch.decay).arg(patch.sustain).arg(patch.release);
+  text += QString("      .lfo={.speed=%1, .attack=%2, .pmd=%3},\n").arg(patch.lfo.speed).arg(patch.lfo.attack).arg(patch.lfo.pmd);
+  text += "      .op=\n";
+  text += "      {\n";
+  for (int i = 0; i < 4; ++i)
+  {
+    const FMSynth::Patch::Operator &op = patch.op[i];
+    text += QString("        {.level=%1, .pitch={.fixed=%2, .coarse=%3, .fine=%4}, ").arg(op.level).arg(op.pitch.fixed ? "true":"false").arg(op.pitch.coarse).arg(op.pitch.fine);
+    text += QString(".detune=%1, .attack=%2, .decay=%3, .sustain=%4, .loop=%5, .waveform=%6}").arg(op.detune).arg(op.attack).arg(op.decay).arg(op.sustain).arg(op.loop ? "true":"false").arg(op.waveform);
+    text += (i < 3) ? ",\n":"\n";
+  }
+  text += "      }\n";
+  text += "    }";
+  return text;
+}
+
+template<typename Envelope>
+static QString envelopeInitializer(const Envelope &env)
+{
+  return QString("{.attack_rate_Q20=%1, .decay_rate_Q20=%2, .release_rate_Q20=%3, .sustain_Q10=%4, .loop=%5}").arg(env.attack_rate_Q20).arg(env.decay_rate_Q20).arg(env.release_rate_Q20).arg(env.sustain_Q10).arg(env.loop ? "true":"false");
+}
+
+//Writes the patch as the FMSynth::BakedPatch initializer of instrument index with the operator rates of keys
+//(ascending), the key and rate arrays it points to go to tables. The values are worked out here rather than
+//by the compiler building the player, so the header only needs FMSynth/CompiledPatch.h.
+template<unsigned Samplerate>
+static QString bakePatch(const FMSynth::Patch &patch, const QList<int> &keys, int index, QString *tables)
+{
+  typename FMSynth::CompiledPatch<Samplerate>::Setup setup = FMSynth::CompiledPatch<Samplerate>::Setup::compile(patch);
+  QString text;
+  auto list = [](const auto *values, int count)
+  {
+    QStringList items;
+    for (int i = 0; i < count; ++i)
+      items += QString::number(values[i]);
+    return "{" + items.join(", ") + "}";
+  };
+  if (!keys.isEmpty())
+  {
+    QStringList keyList;
+    for (auto key : keys)
+      keyList += QString::number(key);
+    *tables += QString("  constexpr std::uint8_t baked_keys%1[] = {%2};\n").arg(index).arg(keyList.join(", "));
+    *tables += QString("  constexpr std::uint32_t baked_rates%1_Q32[][4] =\n").arg(index);
+    *tables += "  {\n";
+    for (int i = 0; i < keys.size(); ++i)
+    {
+      *tables += "    {";
+      for (int op = 0; op < 4; ++op)
+        *tables += QString("%1u%2").arg(FMSynth::Voice<Samplerate>::operatorRate(patch.op[op], keys[i])).arg((op < 3) ? ", ":"");
+      *tables += QString("}%1 //%2\n").arg((i < keys.size() - 1) ? ",":"").arg(keys[i]);
+    }
+    *tables += "  };\n";
+    *tables += "\n";
+  }
+  text += "    {\n";
+  text += "      .setup=\n";
+  text += "      {\n";
+  text += QString("        .op_levels_Q10=%1,\n").arg(list(setup.op_levels_Q10, 4));
+  text += QString("        .op_fixed={%1, %2, %3, %4},\n").arg(setup.op_fixed[0] ? "true":"false").arg(setup.op_fixed[1] ? "true":"false").arg(setup.op_fixed[2] ? "true":"false").arg(setup.op_fixed[3] ? "true":"false");
+  text += "        .op_envs=\n";
+  text += "        {\n";
+  for (int i = 0; i < 4; ++i)
+    text += QString("          %1%2\n").arg(envelopeInitializer(setup.op_envs[i])).arg((i < 3) ? ",":"");
+  text += "        },\n";
+  text += QString("        .wave_masks={%1, %2, %3, %4},\n").arg(list(setup.wave_masks[0], 3)).arg(list(setup.wave_masks[1], 3)).arg(list(setup.wave_masks[2], 3)).arg(list(setup.wave_masks[3], 3));
+  text += QString("        .waveforms=%1,\n").arg(setup.waveforms ? "true":"false");
+  text += QString("        .master_env=%1,\n").arg(envelopeInitializer(setup.master_env));
+  text += QString("        .lfo_rate_Q32=%1u, .lfo_depth_Q10=%2, .lfo_att_rate_Q20=%3,\n").arg(setup.lfo_rate_Q32).arg(setup.lfo_depth_Q10).arg(setup.lfo_att_rate_Q20);
+  text += QString("        .glide=%1, .glide_att_rate_Q20=%2,\n").arg(setup.glide ? "true":"false").arg(setup.glide_att_rate_Q20);
+  text += QString("        .volume_Q10=%1, .fb_level_Q10=%2, .algorithm=%3\n").arg(setup.volume_Q10).arg(setup.fb_level_Q10).arg((int)setup.algorithm);
+  text += "      },\n";
+  if (keys.isEmpty())
+    text += "      .keys=nullptr, .rates_Q32=nullptr, .count=0\n";
+  else
+    text += QString("      .keys=baked_keys%1, .rates_Q32=baked_rates%1_Q32, .count=%2\n").arg(index).arg(keys.size());
+  text += "    }";
+  return text;
+}
+
 FMSong::FMSong()
 {
   Pattern *pattern = new Pattern;
@@ -168,9 +262,206 @@ QJsonObject FMSong::toJson()
   return json;
 }
 
-void FMSong::exportSong(QString file)
+//Writes the song as a C header of constexpr FMSynth::Song tables (see FMSynth/Song.h). Only the patterns
+//and instruments the song's sections use are written, and identical ones are written once. Notes are
+//stored as fixed width records with the offset relative to the previous note.
+//When bakeSamplerate isn't 0 every instrument is also compiled to a FMSynth::BakedPatch for that rate with
+//the operator rates of only the keys it plays, so a player can pass it to Voice::noteOn and skip computing
+//the patch on every note for a few hundred bytes of flash per instrument.
+bool FMSong::exportSong(QString location, unsigned bakeSamplerate, QString *error)
 {
-  //TODO
+  QFile file(location);
+  QString varName = QString("fm%1").arg(name).replace(QRegularExpression("[^a-zA-Z0-9_]+"), "_");
+  QStringList instrumentData;
+  QStringList patternData;
+  QList<int> patternCounts;
+  QMap<FMSynth::Patch*, int> instrumentIndex;
+  QMap<Pattern*, int> patternIndex;
+  QList<QList<int>> instrumentKeys;
+  QString sectionText[4];
+  QString text;
+  int numNotes = 0;
+  auto fail = [error](QString message)
+  {
+    if (error != nullptr)
+      *error = message;
+    return false;
+  };
+  if (bakeSamplerate != 0 && bakeSamplerate != 8000 && bakeSamplerate != 16000 && bakeSamplerate != 22050 && bakeSamplerate != 44100 && bakeSamplerate != 48000)
+    return fail(QString("Unsupported sample rate for compiled instruments: %1").arg(bakeSamplerate));
+  for (int channel = 0; channel < 4; ++channel)
+  {
+    for (auto section : sections[channel])
+    {
+      if (!instrumentIndex.contains(section->instrument))
+      {
+        QString data = patchInitializer(*section->instrument);
+        int index = instrumentData.indexOf(data);
+        if (index == -1)
+        {
+          index = instrumentData.size();
+          instrumentData += data;
+          instrumentKeys += QList<int>();
+        }
+        instrumentIndex.insert(section->instrument, index);
+      }
+      if (!patternIndex.contains(section->pattern))
+      {
+        QList<Note> notes = section->pattern->notes;
+        QString data;
+        int offset = 0;
+        //Notes starting at the same time are played in list order, which a stable sort keeps
+        std::stable_sort(notes.begin(), notes.end(), [](const Note &a, const Note &b) {return a.offset < b.offset;});
+        for (int i = 0; i < notes.size(); ++i)
+        {
+          const Note &note = notes[i];
+          if (note.offset - offset > 0xFFFF || note.duration < 0 || note.duration > 0xFFFF || note.midikey < 0 || note.midikey > 127 || note.velocity < 0 || note.velocity > 127)
+            return fail(QString("A note of pattern \"%1\" doesn't fit in the exported format.").arg(section->pattern->name));
+          data += QString("    {%1, %2, %3, %4}").arg(note.offset - offset).arg(note.duration).arg(note.midikey).arg(note.velocity);
+          data += (i < notes.size() - 1) ? ",\n":"\n";
+          offset = note.offset;
+        }
+        if (notes.size() > 0xFFFF)
+          return fail(QString("Pattern \"%1\" has too many notes.").arg(section->pattern->name));
+        int index = patternData.indexOf(data);
+        if (index == -1)
+        {
+          index = patternData.size();
+          patternData += data;
+          patternCounts += notes.size();
+        }
+        patternIndex.insert(section->pattern, index);
+      }
+      int instrument = instrumentIndex[section->instrument];
+      for (auto &note : section->pattern->notes)
+      {
+        if (!instrumentKeys[instrument].contains(note.midikey))
+          instrumentKeys[instrument] += note.midikey;
+      }
+      if (section->offset < 0)
+        return fail("A section starts before the beginning of the song.");
+      if (!sectionText[channel].isEmpty())
+        sectionText[channel] += ",\n";
+      sectionText[channel] += QString("    {%1, %2, %3}").arg(section->offset).arg(patternIndex[section->pattern]).arg(instrument);
+    }
+  }
+  if (instrumentData.size() > 0xFFFF || patternData.size() > 0xFFFF)
+    return fail("The song has too many patterns or instruments.");
+  text += "#pragma once //auto-generated by FMStudio\n";
+  text += "#include \"FMSynth/Song.h\"\n";
+  if (bakeSamplerate != 0)
+    text += "#include \"FMSynth/CompiledPatch.h\"\n";
+  text += "\n";
+  text += QString("namespace %1\n").arg(varName);
+  text += "{\n";
+  if (instrumentData.size() > 0)
+  {
+    text += "  constexpr FMSynth::Patch instruments[] =\n";
+    text += "  {\n";
+    text += instrumentData.join(",\n") + "\n";
+    text += "  };\n";
+    text += "\n";
+  }
+  for (int i = 0; i < patternData.size(); ++i)
+    numNotes += patternCounts[i];
+  if (numNotes > 0)
+  {
+    //Patterns without notes point at the start of the table and aren't part of it
+    text += "  //delta, duration, midikey, velocity\n";
+    text += "  constexpr FMSynth::Song::Note notes[] =\n";
+    text += "  {\n";
+    for (int i = 0, written = 0; i < patternData.size(); ++i)
+    {
+      if (patternCounts[i] == 0)
+        continue;
+      written += patternCounts[i];
+      text += patternData[i];
+      if (written < numNotes)
+        text.insert(text.size() - 1, ',');
+    }
+    text += "  };\n";
+    text += "\n";
+  }
+  if (patternData.size() > 0)
+  {
+    text += "  constexpr FMSynth::Song::Pattern patterns[] =\n";
+    text += "  {\n";
+    for (int i = 0, first = 0; i < patternData.size(); ++i)
+    {
+      QString patternName = patternIndex.key(i)->name;
+      text += QString("    {%1, %2}%3 //%4\n").arg((patternCounts[i] > 0) ? first:0).arg(patternCounts[i]).arg((i < patternData.size() - 1) ? ",":"").arg(patternName.simplified());
+      first += patternCounts[i];
+    }
+    text += "  };\n";
+    text += "\n";
+  }
+  for (int channel = 0; channel < 4; ++channel)
+  {
+    if (sectionText[channel].isEmpty())
+      continue;
+    text += "  //offset, pattern, instrument\n";
+    text += QString("  constexpr FMSynth::Song::Section channel%1[] =\n").arg(channel);
+    text += "  {\n";
+    text += sectionText[channel] + "\n";
+    text += "  };\n";
+    text += "\n";
+  }
+  if (bakeSamplerate != 0 && instrumentData.size() > 0)
+  {
+    QString tables;
+    QStringList baked;
+    int numKeys = 0;
+    for (int i = 0; i < instrumentData.size(); ++i)
+    {
+      const FMSynth::Patch &patch = *instrumentIndex.key(i);
+      std::sort(instrumentKeys[i].begin(), instrumentKeys[i].end());
+      numKeys += instrumentKeys[i].size();
+      if (bakeSamplerate == 8000)
+        baked += bakePatch<8000>(patch, instrumentKeys[i], i, &tables);
+      else if (bakeSamplerate == 16000)
+        baked += bakePatch<16000>(patch, instrumentKeys[i], i, &tables);
+      else if (bakeSamplerate == 22050)
+        baked += bakePatch<22050>(patch, instrumentKeys[i], i, &tables);
+      else if (bakeSamplerate == 44100)
+        baked += bakePatch<44100>(patch, instrumentKeys[i], i, &tables);
+      else
+        baked += bakePatch<48000>(patch, instrumentKeys[i], i, &tables);
+    }
+    text += tables;
+    //A setup and the table pointers per instrument (pointers as wide as here), a key and 4 rates per key played
+    text += QString("  //About %1 bytes of flash for %2 instruments and %3 keys, a full FMSynth::CompiledPatch takes %4 bytes per instrument\n").arg(instrumentData.size() * (int)sizeof(FMSynth::BakedPatch<8000>) + numKeys * (1 + 4 * 4)).arg(instrumentData.size()).arg(numKeys).arg((int)sizeof(FMSynth::CompiledPatch<8000>));
+    text += QString("  constexpr FMSynth::BakedPatch<%1> compiled_instruments[] =\n").arg(bakeSamplerate);
+    text += "  {\n";
+    text += baked.join(",\n") + "\n";
+    text += "  };\n";
+    text += "\n";
+  }
+  text += "  constexpr FMSynth::Song song =\n";
+  text += "  {\n";
+  text += QString("    .name=\"%1\",\n").arg(escapeString(name));
+  text += QString("    .tempo=%1,\n").arg(tempo);
+  text += QString("    .instruments=%1,\n").arg((instrumentData.size() > 0) ? "instruments":"nullptr");
+  text += QString("    .patterns=%1,\n").arg((patternData.size() > 0) ? "patterns":"nullptr");
+  text += QString("    .notes=%1,\n").arg((numNotes > 0) ? "notes":"nullptr");
+  text += "    .channels=\n";
+  text += "    {\n";
+  for (int channel = 0; channel < 4; ++channel)
+  {
+    if (sectionText[channel].isEmpty())
+      text += "      {nullptr, 0}";
+    else
+      text += QString("      {channel%1, %2}").arg(channel).arg(sections[channel].size());
+    text += (channel < 3) ? ",\n":"\n";
+  }
+  text += "    }\n";
+  text += "  };\n";
+  text += "}\n";
+  if (!file.open(QFile::WriteOnly|QFile::Text))
+    return fail(file.errorString());
+  if (file.write(text.toUtf8()) == -1)
+    return fail(file.errorString());
+  file.close();
+  return true;
 }
 
 FMSong::Pattern *FMSong::getPattern(int id)
@@ -128,7 +128,7 @@ class FMSong
     FMSong(QJsonObject json, const QList<FMSynth::Patch*> &instruments);
     ~FMSong();
     QJsonObject toJson();
-    void exportSong(QString file);
+    bool exportSong(QString location, unsigned bakeSamplerate=0, QString *error=nullptr);
     Pattern *getPattern(int id);
     void addPattern(Pattern *pattern);
     void deletePattern(int id);
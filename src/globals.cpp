@@ -22,8 +22,12 @@
  * SOFTWARE.                                                                      *
  **********************************************************************************/
 
+#ifndef FMSTUDIO_CLI
 #include <QAudioFormat>
 #include <QAudioOutput>
+#include <QMenu>
+#include <QMessageBox>
+#endif
 #include <QCoreApplication>
 #include <QDir>
 #include <QFile>
@@ -31,8 +35,6 @@
 #include <QJsonObject>
 #include <QJsonValue>
 #include <QMap>
-#include <QMenu>
-#include <QMessageBox>
 #include <QRegularExpression>
 #include <QDir>
 #include <QFile>
@@ -54,17 +56,17 @@ bool Globals::firstTimeAudio = true;
 const char *Globals::patchCHeaderTemplate = 
   "#pragma once\n"
   "\n"
-  "FMSynth::Patch patch_%1 =\n"
+  "constexpr FMSynth::Patch patch_%1 =\n"
   "{\n"
   "  .name=\"%2\",\n"
   "  .algorithm=%3, .volume=%4, .feedback=%5, .glide=%6, .attack=%7, .decay=%8, .sustain=%9, .release=%10,\n"
   "  .lfo={.speed=%11, .attack=%12, .pmd=%13},\n"
   "  .op=\n"
   "  {\n"
-  "    {.level=%14, .pitch={.fixed=%15, .coarse=%16, .fine=%17}, .detune=%18, .attack=%19, .decay=%20, .sustain=%21, .loop=%22},\n"
-  "    {.level=%23, .pitch={.fixed=%24, .coarse=%25, .fine=%26}, .detune=%27, .attack=%28, .decay=%29, .sustain=%30, .loop=%31},\n"
-  "    {.level=%32, .pitch={.fixed=%33, .coarse=%34, .fine=%35}, .detune=%36, .attack=%37, .decay=%38, .sustain=%39, .loop=%40},\n"
-  "    {.level=%41, .pitch={.fixed=%42, .coarse=%43, .fine=%44}, .detune=%45, .attack=%46, .decay=%47, .sustain=%48, .loop=%49}\n"
+  "    {.level=%14, .pitch={.fixed=%15, .coarse=%16, .fine=%17}, .detune=%18, .attack=%19, .decay=%20, .sustain=%21, .loop=%22, .waveform=%23},\n"
+  "    {.level=%24, .pitch={.fixed=%25, .coarse=%26, .fine=%27}, .detune=%28, .attack=%29, .decay=%30, .sustain=%31, .loop=%32, .waveform=%33},\n"
+  "    {.level=%34, .pitch={.fixed=%35, .coarse=%36, .fine=%37}, .detune=%38, .attack=%39, .decay=%40, .sustain=%41, .loop=%42, .waveform=%43},\n"
+  "    {.level=%44, .pitch={.fixed=%45, .coarse=%46, .fine=%47}, .detune=%48, .attack=%49, .decay=%50, .sustain=%51, .loop=%52, .waveform=%53}\n"
   "  }\n"
   "};\n";
 
@@ -181,11 +183,13 @@ void Globals::loadInstruments()
       patch.op[i].decay = 0;
       patch.op[i].sustain = 0;
       patch.op[i].loop = false;
+      patch.op[i].waveform = FMSynth::Patch::Operator::Sine;
     }
     patches += patch;
   }
 }
 
+#ifndef FMSTUDIO_CLI
 QMenu *Globals::loadRecentProjects(QWidget *parent)
 {
   QFile file(homePath + "/recent.txt");
@@ -213,6 +217,7 @@ QMenu *Globals::loadRecentProjects(QWidget *parent)
   }
   return menu;
 }
+#endif
 
 void Globals::saveRecentProjects()
 {
@@ -235,20 +240,36 @@ void Globals::addRecentProject(QString name, QString location)
   recentProjects.push_front(project);
 }
 
-QAudioOutput *Globals::createAudioOutput(QWidget *parent)
+#ifndef FMSTUDIO_CLI
+QAudioOutput *Globals::createAudioOutput(QWidget *parent, unsigned samplerate, int sampleSize)
 {
   QAudioFormat audioFormat;
   QAudioDeviceInfo info(QAudioDeviceInfo::defaultOutputDevice());
   audioFormat.setChannelCount(1);
   audioFormat.setCodec("audio/pcm");
-  audioFormat.setSampleType(QAudioFormat::UnSignedInt);
-  audioFormat.setSampleRate(8000);
-  audioFormat.setSampleSize(8);
+  audioFormat.setByteOrder(QAudioFormat::LittleEndian);
+  audioFormat.setSampleRate(samplerate);
+  if (sampleSize == 4)
+  {
+    audioFormat.setSampleType(QAudioFormat::Float);
+    audioFormat.setSampleSize(32);
+  }
+  else if (sampleSize == 2)
+  {
+    audioFormat.setSampleType(QAudioFormat::SignedInt);
+    audioFormat.setSampleSize(16);
+  }
+  else
+  {
+    audioFormat.setSampleType(QAudioFormat::UnSignedInt);
+    audioFormat.setSampleSize(8);
+  }
   if (!info.isFormatSupported(audioFormat) && firstTimeAudio)
     QMessageBox::critical(parent, "Audio Error", "Raw audio format not supported by backend, cannot play audio.");
   firstTimeAudio = false;
   return new QAudioOutput(audioFormat, parent);
 }
+#endif
 
 QString Globals::patchToCHeader(const FMSynth::Patch &patch)
 {
@@ -265,6 +286,7 @@ QString Globals::patchToCHeader(const FMSynth::Patch &patch)
     text = text.arg(patch.op[i].level);
     text = text.arg(patch.op[i].pitch.fixed ? "true":"false").arg(patch.op[i].pitch.coarse).arg(patch.op[i].pitch.fine);
     text = text.arg(patch.op[i].detune).arg(patch.op[i].attack).arg(patch.op[i].decay).arg(patch.op[i].sustain).arg(patch.op[i].loop ? "true":"false");
+    text = text.arg(patch.op[i].waveform);
   }
   return text;
 }
@@ -302,6 +324,7 @@ FMSynth::Patch Globals::patchFromCHeader(const CHeaderObject &data)
     patch.op[i].decay = op["decay"].toInt();
     patch.op[i].sustain = op["sustain"].toInt();
     patch.op[i].loop = op["loop"].toBool();
+    patch.op[i].waveform = op["waveform"].toInt();
   }
   return patch;
 }
@@ -338,6 +361,7 @@ FMSynth::Patch *Globals::patchFromJson(const QJsonObject &json)
     patch->op[i].decay = op["decay"].toInt();
     patch->op[i].sustain = op["sustain"].toInt();
     patch->op[i].loop = op["loop"].toBool();
+    patch->op[i].waveform = op["waveform"].toInt(FMSynth::Patch::Operator::Sine);
   }
   return patch;
 }
@@ -374,6 +398,7 @@ QJsonObject Globals::patchToJson(const FMSynth::Patch *patch)
     op["decay"] = patch->op[i].decay;
     op["sustain"] = patch->op[i].sustain;
     op["loop"] = patch->op[i].loop;
+    op["waveform"] = patch->op[i].waveform;
     array += op;
   }
   json["op"] = array;
@@ -50,7 +50,8 @@ namespace Globals
   QMenu *loadRecentProjects(QWidget *parent);
   void saveRecentProjects();
   void addRecentProject(QString name, QString location);
-  QAudioOutput *createAudioOutput(QWidget *parent=nullptr);
+  //sampleSize is FMSource::bytesPerSample() of the format played: 1 (unsigned 8-bit), 2 (signed 16-bit) or 4 (float)
+  QAudioOutput *createAudioOutput(QWidget *parent=nullptr, unsigned samplerate=8000, int sampleSize=1);
   QString patchToCHeader(const FMSynth::Patch &patch);
   FMSynth::Patch patchFromCHeader(const CHeaderObject &data);
   FMSynth::Patch *patchFromJson(const QJsonObject &json);
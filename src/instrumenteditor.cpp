@@ -48,7 +48,10 @@ const char *InstrumentEditor::helpText =
   "  50% - 75%: Orange (The two sounds are starting to become similar but still needs work).\n"
   "  75% - 90%: Yellow (The two sounds are almost similar enough to be considered okay).\n"
   "  90% - 95%: Yellow-Green (The two sounds are now similar enough to be considered a success).\n"
-  "  95% -100%: Green (The two sounds are similar enough to most likely be indistinguishable for most people).";
+  "  95% -100%: Green (The two sounds are similar enough to most likely be indistinguishable for most people).\n"
+  "\n"
+  "Fit searches for the instrument parameters with the highest likeness rating, starting from the current ones. The instrument is updated every time "
+  "a better match is found, the search stops by itself once no small change improves it any further or when Fit is pressed again.";
 
 InstrumentEditor::InstrumentEditor(QWidget *parent) : QDialog(parent)
 {
@@ -56,6 +59,11 @@ InstrumentEditor::InstrumentEditor(QWidget *parent) : QDialog(parent)
   ignoreEvents = true;
   setupUi(this);
   patch = nullptr;
+  previewRenderer = new PreviewRenderer(this);
+  connect(previewRenderer, SIGNAL(previewReady()), this, SLOT(previewReady()));
+  patchFitter = new PatchFitter(this);
+  connect(patchFitter, SIGNAL(improved()), this, SLOT(fitImproved()));
+  connect(patchFitter, SIGNAL(finished()), this, SLOT(fitFinished()));
   wPatch->setEnabled(false);
   btnCHeaderData->setEnabled(false);
   btnDeleteInstrument->setEnabled(false);
@@ -65,7 +73,7 @@ InstrumentEditor::InstrumentEditor(QWidget *parent) : QDialog(parent)
   ignoreEvents = false;
   lstInstruments->setCurrentRow(0);
   btnDeleteInstrument->setEnabled(Globals::project->numInstruments() > 1);
-  source = new FMSource(1);
+  source = new FMPlayer(1);
   numVolume->setValue(Globals::maxVolume);
   connect(sldrWaveformZoom, SIGNAL(valueChanged(int)), wWaveform, SLOT(setZoomLevel(int)));
   connect(scrlWaveform, SIGNAL(valueChanged(int)), wWaveform, SLOT(setHOffset(int)));
@@ -112,6 +120,7 @@ void InstrumentEditor::on_lstInstruments_currentRowChanged(int currentRow)
     return;
   if (currentRow < 0 || currentRow >= Globals::project->numInstruments())
     return;
+  btnFitSample->setChecked(false);
   wPatch->setEnabled(true);
   btnCHeaderData->setEnabled(true);
   patch = Globals::project->getInstrument(currentRow);
@@ -168,6 +177,7 @@ void InstrumentEditor::on_btnOpenSample_clicked()
   leSampleFile->setText(file);
   btnCloseSample->setEnabled(true);
   btnPlaySample->setEnabled(true);
+  btnFitSample->setEnabled(true);
   loadSampleFile();
 }
 
@@ -176,6 +186,8 @@ void InstrumentEditor::on_btnCloseSample_clicked()
   leSampleFile->setText("");
   btnCloseSample->setEnabled(false);
   btnPlaySample->setEnabled(false);
+  btnFitSample->setChecked(false);
+  btnFitSample->setEnabled(false);
   wWaveform->setShowSecondWaveform(false);
   wSpectrum->setShowSecondSpectrum(false);
   updateLikenessRating();
@@ -190,6 +202,14 @@ void InstrumentEditor::on_btnPlaySample_clicked()
     bytesWritten += out->write(data + bytesWritten, 8000 - bytesWritten);
 }
 
+void InstrumentEditor::on_btnFitSample_toggled(bool on)
+{
+  if (on && patch != nullptr)
+    patchFitter->start(*patch, waveformNote, wSpectrum->getFeatures(1));
+  else
+    patchFitter->stop();
+}
+
 void InstrumentEditor::on_btnHelp_clicked()
 {
   QMessageBox::information(this, "Sample Comparison", helpText);
@@ -351,6 +371,14 @@ void InstrumentEditor::on_sldrOp1Loop_valueChanged(int value)
   updateWaveformPreview();
 }
 
+void InstrumentEditor::on_optOp1Waveform_currentIndexChanged(int index)
+{
+  if (ignoreEvents)
+    return;
+  patch->op[0].waveform = index;
+  updateWaveformPreview();
+}
+
 void InstrumentEditor::on_numOp2Level_valueChanged(int value)
 {
   if (ignoreEvents)
@@ -427,6 +455,14 @@ void InstrumentEditor::on_sldrOp2Loop_valueChanged(int value)
   updateWaveformPreview();
 }
 
+void InstrumentEditor::on_optOp2Waveform_currentIndexChanged(int index)
+{
+  if (ignoreEvents)
+    return;
+  patch->op[1].waveform = index;
+  updateWaveformPreview();
+}
+
 void InstrumentEditor::on_numOp3Level_valueChanged(int value)
 {
   if (ignoreEvents)
@@ -503,6 +539,14 @@ void InstrumentEditor::on_sldrOp3Loop_valueChanged(int value)
   updateWaveformPreview();
 }
 
+void InstrumentEditor::on_optOp3Waveform_currentIndexChanged(int index)
+{
+  if (ignoreEvents)
+    return;
+  patch->op[2].waveform = index;
+  updateWaveformPreview();
+}
+
 void InstrumentEditor::on_numOp4Level_valueChanged(int value)
 {
   if (ignoreEvents)
@@ -579,6 +623,14 @@ void InstrumentEditor::on_sldrOp4Loop_valueChanged(int value)
   updateWaveformPreview();
 }
 
+void InstrumentEditor::on_optOp4Waveform_currentIndexChanged(int index)
+{
+  if (ignoreEvents)
+    return;
+  patch->op[3].waveform = index;
+  updateWaveformPreview();
+}
+
 void InstrumentEditor::on_wKeyboard_notePressed(int midikey)
 {
   source->noteOn(0, *patch, midikey, -1);
@@ -593,6 +645,37 @@ void InstrumentEditor::on_wKeyboard_noteReleased()
   source->noteOff(0);
 }
 
+void InstrumentEditor::previewReady()
+{
+  //Large enough to not belong on the stack
+  static PreviewRenderer::Preview preview;
+  if (!previewRenderer->takePreview(&preview))
+    return;
+  wWaveform->setWaveformData(preview.samples, 0);
+  wSpectrum->setAnalyzedData(preview.features, 0);
+  updateLikenessRating();
+}
+
+void InstrumentEditor::fitImproved()
+{
+  FMSynth::Patch best;
+  double likeness;
+  if (!patchFitter->takeBest(&best, &likeness))
+    return;
+  //Keep the name in case it was edited while fitting
+  memcpy(best.name, patch->name, sizeof(best.name));
+  *patch = best;
+  loadPatchValues();
+  updateWaveformPreview();
+}
+
+void InstrumentEditor::fitFinished()
+{
+  //Ignore a search that ended before the current one started
+  if (!patchFitter->isSearching())
+    btnFitSample->setChecked(false);
+}
+
 void InstrumentEditor::loadPatchValues()
 {
   ignoreEvents = true;
@@ -617,6 +700,7 @@ void InstrumentEditor::loadPatchValues()
   numOp1Decay->setValue(patch->op[0].decay);
   numOp1Sustain->setValue(patch->op[0].sustain);
   sldrOp1Loop->setValue(patch->op[0].loop ? 1:0);
+  optOp1Waveform->setCurrentIndex(patch->op[0].waveform);
   numOp2Level->setValue(patch->op[1].level);
   btnOp2PitchFixed->setChecked(patch->op[1].pitch.fixed);
   numOp2PitchCoarse->setValue(patch->op[1].pitch.coarse);
@@ -626,6 +710,7 @@ void InstrumentEditor::loadPatchValues()
   numOp2Decay->setValue(patch->op[1].decay);
   numOp2Sustain->setValue(patch->op[1].sustain);
   sldrOp2Loop->setValue(patch->op[1].loop ? 1:0);
+  optOp2Waveform->setCurrentIndex(patch->op[1].waveform);
   numOp3Level->setValue(patch->op[2].level);
   btnOp3PitchFixed->setChecked(patch->op[2].pitch.fixed);
   numOp3PitchCoarse->setValue(patch->op[2].pitch.coarse);
@@ -635,6 +720,7 @@ void InstrumentEditor::loadPatchValues()
   numOp3Decay->setValue(patch->op[2].decay);
   numOp3Sustain->setValue(patch->op[2].sustain);
   sldrOp3Loop->setValue(patch->op[2].loop ? 1:0);
+  optOp3Waveform->setCurrentIndex(patch->op[2].waveform);
   numOp4Level->setValue(patch->op[3].level);
   btnOp4PitchFixed->setChecked(patch->op[3].pitch.fixed);
   numOp4PitchCoarse->setValue(patch->op[3].pitch.coarse);
@@ -644,6 +730,7 @@ void InstrumentEditor::loadPatchValues()
   numOp4Decay->setValue(patch->op[3].decay);
   numOp4Sustain->setValue(patch->op[3].sustain);
   sldrOp4Loop->setValue(patch->op[3].loop ? 1:0);
+  optOp4Waveform->setCurrentIndex(patch->op[3].waveform);
   ignoreEvents = false;
 }
 
@@ -652,8 +739,10 @@ void InstrumentEditor::loadSampleFile()
   QFile file(leSampleFile->text());
   qint64 bytesRead;
   uint8_t data[8000];
+  btnFitSample->setChecked(false);
   btnCloseSample->setEnabled(false);
   btnPlaySample->setEnabled(false);
+  btnFitSample->setEnabled(false);
   wWaveform->setWaveformData(data, 1);
   if (!file.open(QFile::ReadOnly))
   {
@@ -686,23 +775,14 @@ void InstrumentEditor::loadSampleFile()
   wSpectrum->setShowSecondSpectrum(true);
   btnCloseSample->setEnabled(true);
   btnPlaySample->setEnabled(true);
+  btnFitSample->setEnabled(true);
   updateLikenessRating();
 }
 
+//Rendering and analysis happen on the preview renderer's thread, previewReady() picks up the result
 void InstrumentEditor::updateWaveformPreview()
 {
-  FMSynth::Voice<8000> voice;
-  uint8_t data[8000];
-  voice.noteOn(*patch, waveformNote, 127);
-  for (int i = 0; i < 8000; ++i)
-  {
-    data[i] = voice.update();
-    if (i == 4000)
-      voice.noteOff();
-  }
-  wWaveform->setWaveformData(data, 0);
-  wSpectrum->setWaveformData(data, 0);
-  updateLikenessRating();
+  previewRenderer->request(*patch, waveformNote);
 }
 
 void InstrumentEditor::updateLikenessRating()
@@ -28,7 +28,9 @@
 #include <QAudioOutput>
 #include <QDialog>
 #include "ui_instrumenteditor.h"
-#include "FMSource.h"
+#include "fmplayer.h"
+#include "patchfitter.h"
+#include "previewrenderer.h"
 
 class InstrumentEditor : public QDialog, public Ui::InstrumentEditor
 {
@@ -49,6 +51,7 @@ class InstrumentEditor : public QDialog, public Ui::InstrumentEditor
     void on_btnOpenSample_clicked();
     void on_btnCloseSample_clicked();
     void on_btnPlaySample_clicked();
+    void on_btnFitSample_toggled(bool on);
     void on_btnHelp_clicked();
     void on_numPatchVolume_valueChanged(int value);
     void on_numPatchFeedback_valueChanged(int value);
@@ -69,6 +72,7 @@ class InstrumentEditor : public QDialog, public Ui::InstrumentEditor
     void on_numOp1Decay_valueChanged(int value);
     void on_numOp1Sustain_valueChanged(int value);
     void on_sldrOp1Loop_valueChanged(int value);
+    void on_optOp1Waveform_currentIndexChanged(int index);
     void on_numOp2Level_valueChanged(int value);
     void on_btnOp2PitchFixed_toggled(bool on);
     void on_numOp2PitchCoarse_valueChanged(int value);
@@ -78,6 +82,7 @@ class InstrumentEditor : public QDialog, public Ui::InstrumentEditor
     void on_numOp2Decay_valueChanged(int value);
     void on_numOp2Sustain_valueChanged(int value);
     void on_sldrOp2Loop_valueChanged(int value);
+    void on_optOp2Waveform_currentIndexChanged(int index);
     void on_numOp3Level_valueChanged(int value);
     void on_btnOp3PitchFixed_toggled(bool on);
     void on_numOp3PitchCoarse_valueChanged(int value);
@@ -87,6 +92,7 @@ class InstrumentEditor : public QDialog, public Ui::InstrumentEditor
     void on_numOp3Decay_valueChanged(int value);
     void on_numOp3Sustain_valueChanged(int value);
     void on_sldrOp3Loop_valueChanged(int value);
+    void on_optOp3Waveform_currentIndexChanged(int index);
     void on_numOp4Level_valueChanged(int value);
     void on_btnOp4PitchFixed_toggled(bool on);
     void on_numOp4PitchCoarse_valueChanged(int value);
@@ -96,8 +102,12 @@ class InstrumentEditor : public QDialog, public Ui::InstrumentEditor
     void on_numOp4Decay_valueChanged(int value);
     void on_numOp4Sustain_valueChanged(int value);
     void on_sldrOp4Loop_valueChanged(int value);
+    void on_optOp4Waveform_currentIndexChanged(int index);
     void on_wKeyboard_notePressed(int midikey);
     void on_wKeyboard_noteReleased();
+    void previewReady();
+    void fitImproved();
+    void fitFinished();
   private:
     void loadPatchValues();
     void loadSampleFile();
@@ -105,7 +115,9 @@ class InstrumentEditor : public QDialog, public Ui::InstrumentEditor
     void updateLikenessRating();
     QAudioOutput *audio;
     FMSynth::Patch *patch;
-    FMSource *source;
+    FMPlayer *source;
+    PreviewRenderer *previewRenderer;
+    PatchFitter *patchFitter;
     static const char *helpText;
     int waveformNote;
     bool ignoreEvents;
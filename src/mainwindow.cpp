@@ -27,6 +27,7 @@
 #include <QAudioOutput>
 #include <QFile>
 #include <QFileDialog>
+#include <QInputDialog>
 #include <QKeyEvent>
 #include <QMainWindow>
 #include <QMenu>
@@ -57,7 +58,9 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent)
   ignoreEvents = true;
   setupUi(this);
   audio = Globals::createAudioOutput(this);
-  source = new FMSource(5);
+  source = new FMPlayer(5);
+  exporter = new SongExporter;
+  exportProgress = nullptr;
   leProjectName->setText(Globals::project->getName());
   optInstrument->clear();
   for (int i = 0; i < Globals::project->numInstruments(); ++i)
@@ -87,11 +90,13 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent)
   connect(wNotes, SIGNAL(playbackFinished()), this, SLOT(playPattern()));
   connect(chkAutoScrollSong, SIGNAL(toggled(bool)), wSections, SLOT(setAutoScroll(bool)));
   connect(chkAutoScrollPattern, SIGNAL(toggled(bool)), wNotes, SLOT(setAutoScroll(bool)));
+  connect(exporter, SIGNAL(finished()), this, SLOT(exportFinished()));
   wNotes->setVirtualKeyboard(wKeyboard);
   setWindowTitle("FMStudio - Untitled");
   menu = new QMenu(this);
   menu->addAction(aExportCHeader);
   menu->addAction(aExportRawAudio);
+  menu->addAction(aExportWavAudio);
   btnExportProject->setMenu(menu);
   numVolume->setValue(Globals::maxVolume);
   if (Globals::geometry.isValid())
@@ -100,6 +105,7 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent)
 
 MainWindow::~MainWindow()
 {
+  delete exporter;
   delete source;
 }
 
@@ -247,38 +253,44 @@ void MainWindow::on_btnSaveProject_clicked()
 }
 
 void MainWindow::on_aExportCHeader_triggered()
-{
-}
-
-void MainWindow::on_aExportRawAudio_triggered()
 {
   QFileInfo info(Globals::project->getLocation());
+  QStringList tables = QStringList() << "None" << "8000 Hz" << "16000 Hz" << "22050 Hz" << "44100 Hz" << "48000 Hz";
+  QString table;
+  bool ok;
   if (!info.exists())
   {
     QMessageBox::critical(this, "Can't Export", "The project needs to be saved to a file before it can be exported.");
     return;
   }
+  //Compiled instruments are only valid for the sample rate the player runs at
+  table = QInputDialog::getItem(this, "Export C Header", "Compiled instruments:", tables, 0, false, &ok);
+  if (!ok)
+    return;
   QDir dir(info.absolutePath());
   dir.mkdir(Globals::project->getName());
   dir.cd(Globals::project->getName());
-  setEnabled(false);
-  QCoreApplication::processEvents();
   for (int i = 0; i < Globals::project->numSongs(); ++i)
   {
     FMSong *s = Globals::project->getSong(i);
-    QFile file(dir.filePath(s->getName() + ".raw"));
-    if (!file.open(QFile::WriteOnly))
+    QString location = dir.filePath(s->getName() + ".h");
+    QString error;
+    if (!s->exportSong(location, table.section(' ', 0, 0).toUInt(), &error))
     {
-      QMessageBox::critical(this, "Export Failed", QString("Failed to export %1 to %2\nReason: %3").arg(s->getName()).arg(file.fileName()).arg(file.errorString()));
+      QMessageBox::critical(this, "Export Failed", QString("Failed to export %1 to %2\nReason: %3").arg(s->getName()).arg(location).arg(error));
       return;
     }
-    source->setTempo(s->getTempo());
-    source->playSong(s);
-    while (!source->atEnd())
-      file.write(source->read(512));
-    file.close();
   }
-  setEnabled(true);
+}
+
+void MainWindow::on_aExportRawAudio_triggered()
+{
+  exportAudio(WavWriter::Container::Raw);
+}
+
+void MainWindow::on_aExportWavAudio_triggered()
+{
+  exportAudio(WavWriter::Container::Wav);
 }
 
 void MainWindow::on_leProjectName_textChanged(QString text)
@@ -623,3 +635,56 @@ void MainWindow::closeEvent(QCloseEvent *event)
   QFile::remove(Globals::homePath + "/backup.fmx");
   event->accept();
 }
+
+//Songs render on the exporter's thread, the editor stays usable and exportFinished() reports the outcome
+void MainWindow::exportAudio(WavWriter::Container container)
+{
+  QFileInfo info(Globals::project->getLocation());
+  QList<FMSong*> songs;
+  if (!info.exists())
+  {
+    QMessageBox::critical(this, "Can't Export", "The project needs to be saved to a file before it can be exported.");
+    return;
+  }
+  if (exporter->isExporting())
+    return;
+  QDir dir(info.absolutePath());
+  dir.mkdir(Globals::project->getName());
+  dir.cd(Globals::project->getName());
+  exportNames.clear();
+  exportLocations.clear();
+  for (int i = 0; i < Globals::project->numSongs(); ++i)
+  {
+    songs += Globals::project->getSong(i);
+    exportNames += songs.last()->getName();
+    exportLocations += dir.filePath(songs.last()->getName() + WavWriter::extension(container));
+  }
+  aExportRawAudio->setEnabled(false);
+  aExportWavAudio->setEnabled(false);
+  exportProgress = new QProgressDialog("Exporting songs...", "Cancel", 0, 100, this);
+  exportProgress->setWindowTitle("Export Audio");
+  exportProgress->setMinimumDuration(0);
+  exportProgress->setValue(0);
+  connect(exporter, SIGNAL(progress(int)), exportProgress, SLOT(setValue(int)));
+  connect(exportProgress, SIGNAL(canceled()), exporter, SLOT(cancel()));
+  exporter->start(songs, exportLocations, container);
+}
+
+void MainWindow::exportFinished()
+{
+  QStringList errors = exporter->errors();
+  exportProgress->deleteLater();
+  exportProgress = nullptr;
+  aExportRawAudio->setEnabled(true);
+  aExportWavAudio->setEnabled(true);
+  if (exporter->wasCancelled())
+    return;
+  for (int i = 0; i < errors.size(); ++i)
+  {
+    if (!errors[i].isEmpty())
+    {
+      QMessageBox::critical(this, "Export Failed", QString("Failed to export %1 to %2\nReason: %3").arg(exportNames[i]).arg(exportLocations[i]).arg(errors[i]));
+      return;
+    }
+  }
+}
@@ -27,9 +27,12 @@
 
 #include <QMainWindow>
 #include <QAudioOutput>
+#include <QProgressDialog>
 #include "ui_mainwindow.h"
 #include "fmsong.h"
-#include "FMSource.h"
+#include "fmplayer.h"
+#include "songexporter.h"
+#include "wavwriter.h"
 
 class MainWindow : public QMainWindow, public Ui::MainWindow
 {
@@ -44,6 +47,7 @@ class MainWindow : public QMainWindow, public Ui::MainWindow
     void on_btnSaveProject_clicked();
     void on_aExportCHeader_triggered();
     void on_aExportRawAudio_triggered();
+    void on_aExportWavAudio_triggered();
     void on_leProjectName_textChanged(QString text);
     void on_optInstrument_currentIndexChanged(int index);
     void on_btnEditInstruments_clicked();
@@ -68,13 +72,19 @@ class MainWindow : public QMainWindow, public Ui::MainWindow
     void on_wKeyboard_noteReleased();
     void playSong(bool force=false);
     void playPattern(bool force=false);
+    void exportFinished();
   private:
     void closeEvent(QCloseEvent *event);
+    void exportAudio(WavWriter::Container container);
     QAudioOutput *audio;
     FMSong *song;
     FMSong::Pattern *pattern;
     FMSynth::Patch *patch;
-    FMSource *source;
+    FMPlayer *source;
+    SongExporter *exporter;
+    QProgressDialog *exportProgress;
+    QStringList exportNames;
+    QStringList exportLocations;
     bool ignoreEvents;
 };
 
@@ -0,0 +1,293 @@
+/**********************************************************************************
+ * MIT License                                                                    *
+ *                                                                                *
+ * Copyright (c) 2023 Justin (tuxinator2009) Davis                                *
+ *                                                                                *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy   *
+ * of this software and associated documentation files (the "Software"), to deal  *
+ * in the Software without restriction, including without limitation the rights   *
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+ * copies of the Software, and to permit persons to whom the Software is          *
+ * furnished to do so, subject to the following conditions:                       *
+ *                                                                                *
+ * The above copyright notice and this permission notice shall be included in all *
+ * copies or substantial portions of the Software.                                *
+ *                                                                                *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+ * SOFTWARE.                                                                      *
+ **********************************************************************************/
+
+#include <QMutexLocker>
+#include <QRunnable>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <vector>
+#include "FMSynth/Voice.h"
+#include "patchfitter.h"
+
+namespace
+{
+  class EvaluationTask : public QRunnable
+  {
+    public:
+      EvaluationTask(std::function<void()> function) : func(function) {}
+      void run() override {func();}
+    private:
+      std::function<void()> func;
+  };
+}
+
+PatchFitter::PatchFitter(QObject *parent) : QObject(parent), _stop(false), _searching(false)
+{
+  _bestLikeness = 0.0;
+  _note = 60;
+  _hasResult = false;
+  _thread = new SearchThread(this);
+}
+
+PatchFitter::~PatchFitter()
+{
+  stop();
+  delete _thread;
+}
+
+void PatchFitter::start(const FMSynth::Patch &patch, int note, const WaveformAnalyzer::Features &reference)
+{
+  stop();
+  _patch = patch;
+  _note = note;
+  _reference = reference;
+  _hasResult = false;
+  _stop = false;
+  _searching = true;
+  _thread->start(QThread::LowPriority);
+}
+
+void PatchFitter::stop()
+{
+  _stop = true;
+  _thread->wait();
+}
+
+bool PatchFitter::takeBest(FMSynth::Patch *patch, double *likeness)
+{
+  QMutexLocker locker(&_mutex);
+  if (!_hasResult)
+    return false;
+  *patch = _best;
+  *likeness = _bestLikeness;
+  _hasResult = false;
+  return true;
+}
+
+void PatchFitter::parameterRange(int index, int *min, int *max)
+{
+  *min = 0;
+  *max = 100;
+  if (index == 0)
+  {
+    *min = 1;
+    *max = 11;
+  }
+  else if (index >= NUM_PATCH_PARAMETERS)
+  {
+    switch ((index - NUM_PATCH_PARAMETERS) % NUM_OPERATOR_PARAMETERS)
+    {
+      case 1: //pitch.fixed
+      case 8: //loop
+        *max = 1;
+        break;
+      case 2: //pitch.coarse
+        *max = 15;
+        break;
+      case 3: //pitch.fine
+        *max = 99;
+        break;
+      case 9: //waveform
+        *max = 3;
+        break;
+    }
+  }
+}
+
+int PatchFitter::getParameter(const FMSynth::Patch &patch, int index)
+{
+  const FMSynth::Patch::Operator *op;
+  switch (index)
+  {
+    case 0: return patch.algorithm;
+    case 1: return patch.feedback;
+    case 2: return patch.attack;
+    case 3: return patch.decay;
+    case 4: return patch.sustain;
+    case 5: return patch.release;
+    case 6: return patch.lfo.speed;
+    case 7: return patch.lfo.attack;
+    case 8: return patch.lfo.pmd;
+  }
+  op = &patch.op[(index - NUM_PATCH_PARAMETERS) / NUM_OPERATOR_PARAMETERS];
+  switch ((index - NUM_PATCH_PARAMETERS) % NUM_OPERATOR_PARAMETERS)
+  {
+    case 0: return op->level;
+    case 1: return op->pitch.fixed ? 1:0;
+    case 2: return op->pitch.coarse;
+    case 3: return op->pitch.fine;
+    case 4: return op->detune;
+    case 5: return op->attack;
+    case 6: return op->decay;
+    case 7: return op->sustain;
+    case 8: return op->loop ? 1:0;
+  }
+  return op->waveform;
+}
+
+void PatchFitter::setParameter(FMSynth::Patch *patch, int index, int value)
+{
+  FMSynth::Patch::Operator *op;
+  switch (index)
+  {
+    case 0: patch->algorithm = value; return;
+    case 1: patch->feedback = value; return;
+    case 2: patch->attack = value; return;
+    case 3: patch->decay = value; return;
+    case 4: patch->sustain = value; return;
+    case 5: patch->release = value; return;
+    case 6: patch->lfo.speed = value; return;
+    case 7: patch->lfo.attack = value; return;
+    case 8: patch->lfo.pmd = value; return;
+  }
+  op = &patch->op[(index - NUM_PATCH_PARAMETERS) / NUM_OPERATOR_PARAMETERS];
+  switch ((index - NUM_PATCH_PARAMETERS) % NUM_OPERATOR_PARAMETERS)
+  {
+    case 0: op->level = value; return;
+    case 1: op->pitch.fixed = value != 0; return;
+    case 2: op->pitch.coarse = value; return;
+    case 3: op->pitch.fine = value; return;
+    case 4: op->detune = value; return;
+    case 5: op->attack = value; return;
+    case 6: op->decay = value; return;
+    case 7: op->sustain = value; return;
+    case 8: op->loop = value != 0; return;
+  }
+  op->waveform = value;
+}
+
+void PatchFitter::search()
+{
+  struct Candidate
+  {
+    FMSynth::Patch patch;
+    double likeness;
+    double distance;
+  };
+  int numWorkers = QThread::idealThreadCount();
+  std::vector<Candidate> candidates;
+  std::vector<uint8_t> samples(numWorkers * WaveformAnalyzer::sampleRate);
+  std::vector<WaveformAnalyzer::Features> features(numWorkers);
+  int steps[NUM_PARAMETERS];
+  Candidate best = {_patch, 0.0, 0.0};
+  best.likeness = evaluate(best.patch, -1.0, samples.data(), features.data(), &best.distance);
+  //Quarter of the range to start with, a single step for switches and waveforms
+  for (int i = 0; i < NUM_PARAMETERS; ++i)
+  {
+    int min, max;
+    parameterRange(i, &min, &max);
+    steps[i] = std::max((max - min) / 4, 1);
+  }
+  _pool.setMaxThreadCount(numWorkers);
+  while (!_stop && best.likeness < 100.0)
+  {
+    std::atomic<int> next(0);
+    //A candidate at least has to match the best likeness to be any better
+    double threshold = best.likeness;
+    int bestCandidate = -1;
+    candidates.clear();
+    for (int i = 0; i < NUM_PARAMETERS; ++i)
+    {
+      int min, max;
+      int value = getParameter(best.patch, i);
+      parameterRange(i, &min, &max);
+      for (int value2 : {std::max(value - steps[i], min), std::min(value + steps[i], max)})
+      {
+        if (value2 == value)
+          continue;
+        candidates.push_back({best.patch, -1.0, 0.0});
+        setParameter(&candidates.back().patch, i, value2);
+      }
+    }
+    for (int worker = 0; worker < numWorkers; ++worker)
+    {
+      _pool.start(new EvaluationTask([&, worker]() {
+        for (int i = next++; i < (int)candidates.size() && !_stop; i = next++)
+          candidates[i].likeness = evaluate(candidates[i].patch, threshold, samples.data() + worker * WaveformAnalyzer::sampleRate, &features[worker], &candidates[i].distance);
+      }));
+    }
+    _pool.waitForDone();
+    if (_stop)
+      break;
+    for (int i = 0; i < (int)candidates.size(); ++i)
+    {
+      const Candidate &candidate = candidates[i];
+      if (candidate.likeness < threshold)
+        continue;
+      if (bestCandidate == -1 || candidate.likeness > candidates[bestCandidate].likeness || (candidate.likeness == candidates[bestCandidate].likeness && candidate.distance < candidates[bestCandidate].distance))
+        bestCandidate = i;
+    }
+    if (bestCandidate != -1 && (candidates[bestCandidate].likeness >= best.likeness + MIN_GAIN || candidates[bestCandidate].distance <= best.distance - MIN_DISTANCE_DROP))
+    {
+      best = candidates[bestCandidate];
+      _mutex.lock();
+      _best = best.patch;
+      _bestLikeness = best.likeness;
+      _hasResult = true;
+      _mutex.unlock();
+      emit improved();
+    }
+    else
+    {
+      //Nothing improved, done once every step is already a single one
+      bool refined = false;
+      for (int i = 0; i < NUM_PARAMETERS; ++i)
+      {
+        if (steps[i] > 1)
+        {
+          steps[i] /= 2;
+          refined = true;
+        }
+      }
+      if (!refined)
+        break;
+    }
+  }
+  _searching = false;
+  emit finished();
+}
+
+//Rendered the same way as PreviewRenderer so the rating matches what the editor shows for the patch.
+//Returns -1 if the partial render already shows the candidate can't reach threshold.
+double PatchFitter::evaluate(const FMSynth::Patch &patch, double threshold, uint8_t *samples, WaveformAnalyzer::Features *features, double *distance)
+{
+  FMSynth::Voice<8000> voice;
+  double likeness;
+  voice.noteOn(patch, _note, 127);
+  for (int i = 0; i < WaveformAnalyzer::sampleRate; ++i)
+  {
+    samples[i] = voice.update();
+    if (i == WaveformAnalyzer::sampleRate / 2)
+      voice.noteOff();
+    if ((i + 1) % CHECKPOINT_INTERVAL == 0 && i + 1 < WaveformAnalyzer::sampleRate && WaveformAnalyzer::calculateLikenessBound(samples, i + 1, _reference) < threshold)
+      return -1.0;
+  }
+  WaveformAnalyzer::analyzeFeatures(samples, features);
+  likeness = WaveformAnalyzer::calculateLikenessRating(*features, _reference, distance);
+  //A silent render can't be normalized, nor can its MFCCs be logged, it rates as NaN or infinity
+  if (!std::isfinite(likeness) || !std::isfinite(*distance))
+    return -1.0;
+  return likeness;
+}
@@ -0,0 +1,97 @@
+/**********************************************************************************
+ * MIT License                                                                    *
+ *                                                                                *
+ * Copyright (c) 2023 Justin (tuxinator2009) Davis                                *
+ *                                                                                *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy   *
+ * of this software and associated documentation files (the "Software"), to deal  *
+ * in the Software without restriction, including without limitation the rights   *
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+ * copies of the Software, and to permit persons to whom the Software is          *
+ * furnished to do so, subject to the following conditions:                       *
+ *                                                                                *
+ * The above copyright notice and this permission notice shall be included in all *
+ * copies or substantial portions of the Software.                                *
+ *                                                                                *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+ * SOFTWARE.                                                                      *
+ **********************************************************************************/
+
+#ifndef PATCHFITTER_H
+#define PATCHFITTER_H
+
+#include <QMutex>
+#include <QObject>
+#include <QThread>
+#include <QThreadPool>
+#include <atomic>
+#include "FMSynth/Patch.h"
+#include "waveformanalyzer.h"
+
+//Searches for the patch parameters that sound most like a reference sample, starting from the patch being edited.
+//The search is a pattern search (coordinate descent on all parameters at once): every round tries each parameter
+//one step up and down from the best patch so far and moves to the best candidate, steps are halved when nothing
+//improves and the search ends once single steps don't improve either. Candidates with the same likeness rating
+//are told apart by their unclamped distance so the search keeps moving where the rating is flat. Candidates are rendered and rated on a
+//thread pool, each worker with its own Voice<8000>, and a candidate is dropped as soon as a partial render
+//proves it can't beat the best patch (see WaveformAnalyzer::calculateLikenessBound()).
+class PatchFitter : public QObject
+{
+  Q_OBJECT
+  public:
+    PatchFitter(QObject *parent=nullptr);
+    ~PatchFitter();
+    //Starts searching from patch, rating it playing note against reference, improved() is emitted for every better patch
+    void start(const FMSynth::Patch &patch, int note, const WaveformAnalyzer::Features &reference);
+    //Stops the search and waits for it, finished() is still emitted
+    void stop();
+    //False once the search has ended, a queued finished() from an earlier search can arrive after a new start()
+    bool isSearching() const {return _searching;}
+    //Copies the best patch found so far into patch, returns false if there is none since the last call
+    bool takeBest(FMSynth::Patch *patch, double *likeness);
+  signals:
+    void improved();
+    void finished();
+  private:
+    class SearchThread : public QThread
+    {
+      public:
+        SearchThread(PatchFitter *fitter) : fitter(fitter) {}
+      protected:
+        void run() override {fitter->search();}
+      private:
+        PatchFitter *fitter;
+    };
+    //Every parameter that changes the sound of a single note, volume and glide don't
+    static constexpr int NUM_PATCH_PARAMETERS = 9;
+    static constexpr int NUM_OPERATOR_PARAMETERS = 10;
+    static constexpr int NUM_PARAMETERS = NUM_PATCH_PARAMETERS + 4 * NUM_OPERATOR_PARAMETERS;
+    //Samples between the checks of a partially rendered candidate against the best patch
+    static constexpr int CHECKPOINT_INTERVAL = WaveformAnalyzer::sampleRate / 4;
+    //Smallest gain in likeness (in percent), or drop in distance at the same likeness, that counts as an improvement
+    static constexpr double MIN_GAIN = 0.001;
+    static constexpr double MIN_DISTANCE_DROP = 0.0001;
+    static void parameterRange(int index, int *min, int *max);
+    static int getParameter(const FMSynth::Patch &patch, int index);
+    static void setParameter(FMSynth::Patch *patch, int index, int value);
+    void search();
+    double evaluate(const FMSynth::Patch &patch, double threshold, uint8_t *samples, WaveformAnalyzer::Features *features, double *distance);
+    QThreadPool _pool;
+    QMutex _mutex;
+    WaveformAnalyzer::Features _reference;
+    FMSynth::Patch _patch;
+    FMSynth::Patch _best;
+    SearchThread *_thread;
+    std::atomic<bool> _stop;
+    std::atomic<bool> _searching;
+    double _bestLikeness;
+    int _note;
+    bool _hasResult;
+};
+
+#endif //PATCHFITTER_H
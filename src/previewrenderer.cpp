@@ -0,0 +1,147 @@
+/**********************************************************************************
+ * MIT License                                                                    *
+ *                                                                                *
+ * Copyright (c) 2023 Justin (tuxinator2009) Davis                                *
+ *                                                                                *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy   *
+ * of this software and associated documentation files (the "Software"), to deal  *
+ * in the Software without restriction, including without limitation the rights   *
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+ * copies of the Software, and to permit persons to whom the Software is          *
+ * furnished to do so, subject to the following conditions:                       *
+ *                                                                                *
+ * The above copyright notice and this permission notice shall be included in all *
+ * copies or substantial portions of the Software.                                *
+ *                                                                                *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+ * SOFTWARE.                                                                      *
+ **********************************************************************************/
+
+#include <QMutexLocker>
+#include "FMSynth/Voice.h"
+#include "previewrenderer.h"
+
+PreviewRenderer::PreviewRenderer(QObject *parent) : QObject(parent), _cache(CACHE_SIZE)
+{
+  _generation = 0;
+  _note = 60;
+  _pending = false;
+  _hasResult = false;
+  _quit = false;
+  _thread = new WorkerThread(this);
+  _thread->start(QThread::LowPriority);
+}
+
+PreviewRenderer::~PreviewRenderer()
+{
+  _mutex.lock();
+  _quit = true;
+  ++_generation;
+  _wake.wakeOne();
+  _mutex.unlock();
+  _thread->wait();
+  delete _thread;
+}
+
+void PreviewRenderer::request(const FMSynth::Patch &patch, int note)
+{
+  QMutexLocker locker(&_mutex);
+  Preview *cached = _cache.object(cacheKey(patch, note));
+  //Any render still running is for an older state of the patch
+  ++_generation;
+  if (cached != nullptr)
+  {
+    _pending = false;
+    _result = *cached;
+    _hasResult = true;
+    locker.unlock();
+    emit previewReady();
+    return;
+  }
+  _patch = patch;
+  _note = note;
+  _pending = true;
+  _wake.wakeOne();
+}
+
+bool PreviewRenderer::takePreview(Preview *preview)
+{
+  QMutexLocker locker(&_mutex);
+  if (!_hasResult)
+    return false;
+  *preview = _result;
+  _hasResult = false;
+  return true;
+}
+
+//The name doesn't change the sound, everything after it does
+QByteArray PreviewRenderer::cacheKey(const FMSynth::Patch &patch, int note)
+{
+  QByteArray key((const char*)&patch + sizeof(patch.name), sizeof(patch) - sizeof(patch.name));
+  key.append((char)note);
+  return key;
+}
+
+bool PreviewRenderer::cancelled(quint64 generation)
+{
+  QMutexLocker locker(&_mutex);
+  return generation != _generation;
+}
+
+void PreviewRenderer::workerLoop()
+{
+  Preview *preview = new Preview;
+  for (;;)
+  {
+    FMSynth::Patch patch;
+    FMSynth::Voice<8000> voice;
+    quint64 generation;
+    int note;
+    _mutex.lock();
+    while (!_pending && !_quit)
+      _wake.wait(&_mutex);
+    if (_quit)
+    {
+      _mutex.unlock();
+      break;
+    }
+    patch = _patch;
+    note = _note;
+    generation = _generation;
+    _pending = false;
+    _mutex.unlock();
+    voice.noteOn(patch, note, 127);
+    for (int i = 0; i < WaveformAnalyzer::sampleRate; ++i)
+    {
+      preview->samples[i] = voice.update();
+      if (i == WaveformAnalyzer::sampleRate / 2)
+        voice.noteOff();
+    }
+    if (cancelled(generation))
+      continue;
+    WaveformAnalyzer::analyzeSamples(preview->samples, preview->features.waveform, preview->features.spectrum);
+    if (cancelled(generation))
+      continue;
+    WaveformAnalyzer::calculateMFCCs(preview->features.spectrum, preview->features.mfccs);
+    WaveformAnalyzer::calculateAmplitudeEnvelope(preview->features.waveform, preview->features.windowAverage, preview->features.windowMax);
+    _mutex.lock();
+    //QCache takes ownership, the next render gets a fresh buffer
+    _cache.insert(cacheKey(patch, note), preview);
+    if (generation == _generation)
+    {
+      _result = *preview;
+      _hasResult = true;
+      _mutex.unlock();
+      emit previewReady();
+    }
+    else
+      _mutex.unlock();
+    preview = new Preview;
+  }
+  delete preview;
+}
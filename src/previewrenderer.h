@@ -0,0 +1,85 @@
+/**********************************************************************************
+ * MIT License                                                                    *
+ *                                                                                *
+ * Copyright (c) 2023 Justin (tuxinator2009) Davis                                *
+ *                                                                                *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy   *
+ * of this software and associated documentation files (the "Software"), to deal  *
+ * in the Software without restriction, including without limitation the rights   *
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+ * copies of the Software, and to permit persons to whom the Software is          *
+ * furnished to do so, subject to the following conditions:                       *
+ *                                                                                *
+ * The above copyright notice and this permission notice shall be included in all *
+ * copies or substantial portions of the Software.                                *
+ *                                                                                *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+ * SOFTWARE.                                                                      *
+ **********************************************************************************/
+
+#ifndef PREVIEWRENDERER_H
+#define PREVIEWRENDERER_H
+
+#include <QByteArray>
+#include <QCache>
+#include <QMutex>
+#include <QObject>
+#include <QThread>
+#include <QWaitCondition>
+#include "FMSynth/Patch.h"
+#include "waveformanalyzer.h"
+
+//Renders the InstrumentEditor's waveform preview together with its analysis (normalized waveform, spectrum,
+//MFCCs and amplitude envelope) on a worker thread so dragging a slider never waits on the synth or the FFT. Requests are
+//coalesced, only the latest one is rendered and a render that gets overtaken by a newer request is dropped
+//between stages. Finished previews are cached by patch so going back to an earlier value is instant.
+class PreviewRenderer : public QObject
+{
+  Q_OBJECT
+  public:
+    struct Preview
+    {
+      uint8_t samples[WaveformAnalyzer::sampleRate];
+      WaveformAnalyzer::Features features;
+    };
+    PreviewRenderer(QObject *parent=nullptr);
+    ~PreviewRenderer();
+    //Asks for a preview of patch playing note, previewReady() is emitted once it is available
+    void request(const FMSynth::Patch &patch, int note);
+    //Copies the latest preview into preview, returns false if there is none since the last call
+    bool takePreview(Preview *preview);
+  signals:
+    void previewReady();
+  private:
+    class WorkerThread : public QThread
+    {
+      public:
+        WorkerThread(PreviewRenderer *renderer) : renderer(renderer) {}
+      protected:
+        void run() override {renderer->workerLoop();}
+      private:
+        PreviewRenderer *renderer;
+    };
+    static constexpr int CACHE_SIZE = 64;
+    static QByteArray cacheKey(const FMSynth::Patch &patch, int note);
+    void workerLoop();
+    bool cancelled(quint64 generation);
+    QCache<QByteArray, Preview> _cache;
+    QMutex _mutex;
+    QWaitCondition _wake;
+    FMSynth::Patch _patch;
+    Preview _result;
+    WorkerThread *_thread;
+    quint64 _generation;
+    int _note;
+    bool _pending;
+    bool _hasResult;
+    bool _quit;
+};
+
+#endif //PREVIEWRENDERER_H
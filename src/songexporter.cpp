@@ -0,0 +1,97 @@
+/**********************************************************************************
+ * MIT License                                                                    *
+ *                                                                                *
+ * Copyright (c) 2023 Justin (tuxinator2009) Davis                                *
+ *                                                                                *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy   *
+ * of this software and associated documentation files (the "Software"), to deal  *
+ * in the Software without restriction, including without limitation the rights   *
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+ * copies of the Software, and to permit persons to whom the Software is          *
+ * furnished to do so, subject to the following conditions:                       *
+ *                                                                                *
+ * The above copyright notice and this permission notice shall be included in all *
+ * copies or substantial portions of the Software.                                *
+ *                                                                                *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+ * SOFTWARE.                                                                      *
+ **********************************************************************************/
+
+
+#include "fmsong.h"
+#include "songexporter.h"
+
+SongExporter::SongExporter(QObject *parent) : QObject(parent), _cancel(false), _exporting(false)
+{
+  _container = WavWriter::Container::Wav;
+  _percent = 0;
+  _thread = new ExportThread(this);
+}
+
+SongExporter::~SongExporter()
+{
+  cancel();
+  _thread->wait();
+  delete _thread;
+}
+
+void SongExporter::start(const QList<FMSong*> &songs, const QStringList &locations, WavWriter::Container container)
+{
+  cancel();
+  _thread->wait();
+  //The only place the songs are read, the export thread renders the snapshots
+  for (auto song : songs)
+    _songs += _renderer.snapshot(song);
+  _locations = locations;
+  _container = container;
+  _errors.clear();
+  _fractions.fill(0.0, songs.size());
+  _percent = 0;
+  _cancel = false;
+  _exporting = true;
+  _thread->start(QThread::LowPriority);
+}
+
+void SongExporter::cancel()
+{
+  if (_exporting)
+    _cancel = true;
+}
+
+QStringList SongExporter::errors()
+{
+  QMutexLocker locker(&_mutex);
+  return _errors;
+}
+
+void SongExporter::exportSongs()
+{
+  QStringList errors = _renderer.exportSongs(_songs, _locations, _container, [this](int song, double fraction) {return songProgress(song, fraction);});
+  _songs.clear();
+  _mutex.lock();
+  _errors = errors;
+  _mutex.unlock();
+  _exporting = false;
+  emit finished();
+}
+
+//Called from the render threads, every song counts the same towards the total
+bool SongExporter::songProgress(int song, double fraction)
+{
+  QMutexLocker locker(&_mutex);
+  double total = 0.0;
+  _fractions[song] = fraction;
+  for (auto f : _fractions)
+    total += f;
+  if ((int)(total * 100 / _fractions.size()) != _percent)
+  {
+    _percent = total * 100 / _fractions.size();
+    emit progress(_percent);
+  }
+  return !_cancel;
+}
@@ -0,0 +1,88 @@
+/**********************************************************************************
+ * MIT License                                                                    *
+ *                                                                                *
+ * Copyright (c) 2023 Justin (tuxinator2009) Davis                                *
+ *                                                                                *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy   *
+ * of this software and associated documentation files (the "Software"), to deal  *
+ * in the Software without restriction, including without limitation the rights   *
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+ * copies of the Software, and to permit persons to whom the Software is          *
+ * furnished to do so, subject to the following conditions:                       *
+ *                                                                                *
+ * The above copyright notice and this permission notice shall be included in all *
+ * copies or substantial portions of the Software.                                *
+ *                                                                                *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+ * SOFTWARE.                                                                      *
+ **********************************************************************************/
+
+
+#ifndef SONGEXPORTER_H
+#define SONGEXPORTER_H
+
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QStringList>
+#include <QThread>
+#include <QVector>
+#include <atomic>
+#include "songrenderer.h"
+#include "wavwriter.h"
+
+class FMSong;
+
+//Exports songs to audio files on a background thread so the editor stays usable while they render. The songs
+//are snapshotted when the export starts (see SongRenderer::Snapshot), they can be edited or deleted right after.
+//progress() is emitted as the songs render and finished() once every file is written or the export was cancelled.
+class SongExporter : public QObject
+{
+  Q_OBJECT
+  public:
+    SongExporter(QObject *parent=nullptr);
+    //Cancels a running export and waits for it
+    ~SongExporter();
+    void start(const QList<FMSong*> &songs, const QStringList &locations, WavWriter::Container container);
+    bool isExporting() const {return _exporting;}
+    bool wasCancelled() const {return _cancel;}
+    //One error per song of the last export, empty if it was exported
+    QStringList errors();
+  public slots:
+    //Stops rendering, files not finished yet are removed. finished() is still emitted.
+    void cancel();
+  signals:
+    //Percent of the whole export done
+    void progress(int percent);
+    void finished();
+  private:
+    class ExportThread : public QThread
+    {
+      public:
+        ExportThread(SongExporter *exporter) : exporter(exporter) {}
+      protected:
+        void run() override {exporter->exportSongs();}
+      private:
+        SongExporter *exporter;
+    };
+    void exportSongs();
+    bool songProgress(int song, double fraction);
+    SongRenderer _renderer;
+    QMutex _mutex;
+    QList<SongRenderer::Snapshot*> _songs;
+    QStringList _locations;
+    QStringList _errors;
+    QVector<double> _fractions;
+    WavWriter::Container _container;
+    ExportThread *_thread;
+    std::atomic<bool> _cancel;
+    std::atomic<bool> _exporting;
+    int _percent;
+};
+
+#endif //SONGEXPORTER_H
@@ -0,0 +1,230 @@
+/**********************************************************************************
+ * MIT License                                                                    *
+ *                                                                                *
+ * Copyright (c) 2023 Justin (tuxinator2009) Davis                                *
+ *                                                                                *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy   *
+ * of this software and associated documentation files (the "Software"), to deal  *
+ * in the Software without restriction, including without limitation the rights   *
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+ * copies of the Software, and to permit persons to whom the Software is          *
+ * furnished to do so, subject to the following conditions:                       *
+ *                                                                                *
+ * The above copyright notice and this permission notice shall be included in all *
+ * copies or substantial portions of the Software.                                *
+ *                                                                                *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+ * SOFTWARE.                                                                      *
+ **********************************************************************************/
+
+#include <algorithm>
+#include <functional>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include "FMSource.h"
+#include "FMSynth/Decimator.h"
+#include "fmsong.h"
+#include "songrenderer.h"
+
+namespace
+{
+  class FunctionTask : public QRunnable
+  {
+    public:
+      FunctionTask(std::function<void()> function) : func(function) {}
+      void run() override {func();}
+    private:
+      std::function<void()> func;
+  };
+}
+
+SongRenderer::SongRenderer(int maxThreads, unsigned samplerate, FMSource::SampleFormat format)
+{
+  this->maxThreads = (maxThreads > 0) ? maxThreads:QThread::idealThreadCount();
+  this->samplerate = samplerate;
+  this->format = format;
+  bandlimited = false;
+  oversampling = 1;
+}
+
+bool SongRenderer::isSupportedOversampling(unsigned samplerate, unsigned factor)
+{
+  if (factor == 1)
+    return true;
+  return (factor == 2 || factor == 4) && FMSource::isSupportedVoiceRate(samplerate * factor);
+}
+
+SongRenderer::Snapshot::~Snapshot()
+{
+  for (int channel = 0; channel < 4; ++channel)
+    delete scores[channel];
+}
+
+SongRenderer::Snapshot *SongRenderer::snapshot(FMSong *song) const
+{
+  Snapshot *snapshot = new Snapshot;
+  FMSource::Score *score = FMSource::compileSong(song, samplerate * oversampling, song->getTempo());
+  snapshot->length = score->length();
+  for (int channel = 0; channel < 4; ++channel)
+    snapshot->scores[channel] = score->takeChannel(channel);
+  delete score;
+  return snapshot;
+}
+
+QByteArray SongRenderer::renderSong(FMSong *song)
+{
+  return renderSongs(QList<FMSong*>() << song).first();
+}
+
+QList<QByteArray> SongRenderer::renderSongs(const QList<FMSong*> &songs)
+{
+  QVector<QByteArray> output(songs.size());
+  QVector<Snapshot*> snapshots;
+  QByteArray *data = output.data();
+  int sampleSize = FMSource::bytesPerSample(format);
+  for (auto song : songs)
+    snapshots += snapshot(song);
+  forEachSong(songs.size(), [&](int i, int threads) {
+    streamSong(snapshots[i], threads, [&](const int32_t *bus, qint64 numSamples) {
+      qint64 offset = data[i].size();
+      data[i].resize(offset + numSamples * sampleSize);
+      FMSource::convert(bus, data[i].data() + offset, numSamples, format);
+      return true;
+    });
+    delete snapshots[i];
+  });
+  return output.toList();
+}
+
+QStringList SongRenderer::exportSongs(const QList<FMSong*> &songs, const QStringList &locations, WavWriter::Container container)
+{
+  QList<Snapshot*> snapshots;
+  for (auto song : songs)
+    snapshots += snapshot(song);
+  return exportSongs(snapshots, locations, container, nullptr);
+}
+
+QStringList SongRenderer::exportSongs(const QList<Snapshot*> &songs, const QStringList &locations, WavWriter::Container container, const std::function<bool(int, double)> &progress)
+{
+  QVector<QString> errors(songs.size());
+  QString *error = errors.data();
+  forEachSong(songs.size(), [&](int i, int threads) {
+    WavWriter writer(samplerate, format, container);
+    qint64 rendered = 0;
+    qint64 length = qMax(songs[i]->length, (qint64)1);
+    if (progress && !progress(i, 0.0))
+    {
+      error[i] = "The export was cancelled.";
+      delete songs[i];
+      return;
+    }
+    writer.setUncached(true);
+    auto write = [&](const int32_t *bus, qint64 numSamples) {
+      if (!writer.write(bus, numSamples))
+        return false;
+      rendered += numSamples * oversampling;
+      if (progress && !progress(i, qMin(rendered, length) / (double)length))
+      {
+        writer.fail("The export was cancelled.");
+        return false;
+      }
+      return true;
+    };
+    if (!writer.open(locations[i]) || !streamSong(songs[i], threads, write) || !writer.close())
+      error[i] = writer.errorString();
+    delete songs[i];
+  });
+  return errors.toList();
+}
+
+//Calls func(i, threads) for every song, as many songs at a time as there are threads. Each song gets
+//the threads left over (up to one per channel) to render its channels with.
+void SongRenderer::forEachSong(int count, const std::function<void(int, int)> &func)
+{
+  int songThreads = qMin(count, maxThreads);
+  int channelThreads = qBound(1, maxThreads / qMax(songThreads, 1), 4);
+  if (songThreads <= 1)
+  {
+    for (int i = 0; i < count; ++i)
+      func(i, channelThreads);
+    return;
+  }
+  QThreadPool pool;
+  pool.setMaxThreadCount(songThreads);
+  for (int i = 0; i < count; ++i)
+    pool.start(new FunctionTask([&func, i, channelThreads]() {func(i, channelThreads);}));
+  pool.waitForDone();
+}
+
+//Renders the song chunk by chunk and hands every mixed (and decimated) chunk to output, stops early and
+//returns false when output does. Each channel gets its own FMSource that only renders that channel.
+bool SongRenderer::streamSong(Snapshot *song, int threads, const std::function<bool(const int32_t*, qint64)> &output)
+{
+  ChannelJob jobs[4];
+  QVector<int32_t> bus(CHUNK_SIZE + FMSynth::Decimator::MAX_FINISH);
+  FMSynth::Decimator decimator(oversampling);
+  QThreadPool pool;
+  bool ok = true;
+  pool.setMaxThreadCount(threads);
+  for (int channel = 0; channel < 4; ++channel)
+  {
+    jobs[channel].source = new FMSource(4, samplerate * oversampling);
+    jobs[channel].source->setBandlimited(bandlimited);
+    jobs[channel].source->play(song->scores[channel]);
+    song->scores[channel] = nullptr;
+    jobs[channel].channel = channel;
+    jobs[channel].bus.resize(CHUNK_SIZE);
+  }
+  for (;;)
+  {
+    qint64 length = 0;
+    for (int channel = 0; channel < 4; ++channel)
+    {
+      ChannelJob *job = &jobs[channel];
+      if (threads > 1)
+        pool.start(new FunctionTask([job]() {renderChunk(job);}));
+      else
+        renderChunk(job);
+    }
+    pool.waitForDone();
+    for (int channel = 0; channel < 4; ++channel)
+      length = qMax(length, jobs[channel].length);
+    if (length == 0)
+      break;
+    std::fill(bus.begin(), bus.begin() + length, 0);
+    for (int channel = 0; channel < 4; ++channel)
+    {
+      const int32_t *in = jobs[channel].bus.constData();
+      for (qint64 i = 0; i < jobs[channel].length; ++i)
+        bus[i] += in[i];
+    }
+    if (!output(bus.constData(), decimator.process(bus.constData(), length, bus.data())))
+    {
+      ok = false;
+      break;
+    }
+  }
+  if (ok)
+    ok = output(bus.constData(), decimator.finish(bus.data()));
+  for (int channel = 0; channel < 4; ++channel)
+    delete jobs[channel].source;
+  return ok;
+}
+
+//FMSource is read in 512 sample blocks until it reports the end so channels are rendered in blocks of the same size
+void SongRenderer::renderChunk(ChannelJob *job)
+{
+  job->length = 0;
+  while (job->length < CHUNK_SIZE && !job->source->channelAtEnd(job->channel))
+  {
+    std::fill(job->bus.begin() + job->length, job->bus.begin() + job->length + 512, 0);
+    job->source->renderChannel(job->channel, job->bus.data() + job->length, 512);
+    job->length += 512;
+  }
+}
@@ -0,0 +1,97 @@
+/**********************************************************************************
+ * MIT License                                                                    *
+ *                                                                                *
+ * Copyright (c) 2023 Justin (tuxinator2009) Davis                                *
+ *                                                                                *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy   *
+ * of this software and associated documentation files (the "Software"), to deal  *
+ * in the Software without restriction, including without limitation the rights   *
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+ * copies of the Software, and to permit persons to whom the Software is          *
+ * furnished to do so, subject to the following conditions:                       *
+ *                                                                                *
+ * The above copyright notice and this permission notice shall be included in all *
+ * copies or substantial portions of the Software.                                *
+ *                                                                                *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+ * SOFTWARE.                                                                      *
+ **********************************************************************************/
+
+#ifndef SONGRENDERER_H
+#define SONGRENDERER_H
+
+#include <functional>
+#include <QByteArray>
+#include <QList>
+#include <QStringList>
+#include <QVector>
+#include "FMSource.h"
+#include "wavwriter.h"
+
+class FMSong;
+
+//Renders songs offline without an audio device. A song is streamed a chunk at a time: its four channels
+//render the chunk on worker threads, then their buses are summed so the output is identical to reading
+//the song from an FMSource. Memory use doesn't grow with the length of the songs. A batch streams as
+//many songs at a time as there are threads and gives threads left over to their channels.
+//With oversampling the voices run at 2x or 4x the output rate and the mixed bus is decimated back to
+//it, which keeps aliasing of feedback and high operator ratios out of exports. Playback doesn't do this.
+//Songs are compiled into a Snapshot before they render, so only snapshot() ever reads a FMSong.
+class SongRenderer
+{
+  public:
+    class Snapshot;
+    SongRenderer(int maxThreads=0, unsigned samplerate=8000, FMSource::SampleFormat format=FMSource::SampleFormat::UInt8);
+    void setBandlimited(bool enabled) {bandlimited = enabled;}
+    //1 (off), 2 or 4, the oversampled rate has to be one FMSource::isSupportedVoiceRate() accepts
+    static bool isSupportedOversampling(unsigned samplerate, unsigned factor);
+    void setOversampling(unsigned factor) {oversampling = factor;}
+    //Compiles song for this renderer's sample rate and oversampling, see Snapshot
+    Snapshot *snapshot(FMSong *song) const;
+    QByteArray renderSong(FMSong *song);
+    QList<QByteArray> renderSongs(const QList<FMSong*> &songs);
+    //Streams songs straight to the files at locations through a WavWriter, so no song is ever held in
+    //memory as a whole. Returns one error per song, empty if it was exported.
+    QStringList exportSongs(const QList<FMSong*> &songs, const QStringList &locations, WavWriter::Container container);
+    //Same as above for songs snapshotted beforehand, which it takes over. progress(song, fraction) is called
+    //from the render threads after every chunk of a song, returning false cancels the export: files not
+    //finished yet are removed and get an error.
+    QStringList exportSongs(const QList<Snapshot*> &songs, const QStringList &locations, WavWriter::Container container, const std::function<bool(int, double)> &progress);
+  private:
+    //Samples (at the voice rate) each channel renders per chunk, a multiple of FMSource's 512 sample blocks
+    static constexpr qint64 CHUNK_SIZE = 64 * 512;
+    struct ChannelJob
+    {
+      FMSource *source;
+      int channel;
+      QVector<int32_t> bus;
+      qint64 length;
+    };
+    void forEachSong(int count, const std::function<void(int, int)> &func);
+    bool streamSong(Snapshot *song, int threads, const std::function<bool(const int32_t*, qint64)> &output);
+    static void renderChunk(ChannelJob *job);
+    int maxThreads;
+    unsigned samplerate;
+    FMSource::SampleFormat format;
+    bool bandlimited;
+    unsigned oversampling;
+};
+
+//A song compiled for rendering (one FMSource::Score per channel). It keeps no reference to the song, so it can
+//be taken on the thread that edits the song and rendered on any other. Rendering uses it up.
+class SongRenderer::Snapshot
+{
+  public:
+    ~Snapshot();
+  private:
+    friend class SongRenderer;
+    FMSource::Score *scores[4];
+    qint64 length; //at the voice rate, up to the end of the last note
+};
+
+#endif //SONGRENDERER_H
@@ -28,21 +28,14 @@
 #include <QWidget>
 #include <complex>
 #include <cmath>
+#include <cstring>
+#include "featurecache.h"
 #include "spectrumpreview.h"
 #include "waveformanalyzer.h"
 
 SpectrumPreview::SpectrumPreview(QWidget *parent) : QWidget(parent)
 {
-  for (int i = 0; i < 8192; ++i)
-  {
-    waveforms[0][i] = 0.0;
-    waveforms[1][i] = 0.0;
-  }
-  for (int i = 0; i < 4097; ++i)
-  {
-    spectrum[0][i] = 0.0;
-    spectrum[1][i] = 0.0;
-  }
+  memset(features, 0, sizeof(features));
   zoom = 0;
   hOffset = 0;
   showSecondSpectrum = false;
@@ -55,16 +48,14 @@ SpectrumPreview::~SpectrumPreview()
 
 void SpectrumPreview::setWaveformData(const uint8_t *data, int id)
 {
-  std::complex<double> input[WaveformAnalyzer::numSamples];
-  for (int i = 0; i < WaveformAnalyzer::sampleRate; ++i)
-    waveforms[id][i] = data[i] / 128.0 - 1.0;
-  for (int i = WaveformAnalyzer::sampleRate; i < WaveformAnalyzer::numSamples; ++i)
-    waveforms[id][i] = 0.0;
-  WaveformAnalyzer::normalize(waveforms[id], WaveformAnalyzer::numSamples);
-  for (int i = 0; i < WaveformAnalyzer::numSamples; ++i)
-    input[i] = waveforms[id][i];
-  WaveformAnalyzer::fft(input);
-  normalizeSpectrum(input, spectrum[id]);
+  FeatureCache::analyze(data, &features[id]);
+  if (id == 0 || showSecondSpectrum)
+    update();
+}
+
+void SpectrumPreview::setAnalyzedData(const WaveformAnalyzer::Features &features, int id)
+{
+  this->features[id] = features;
   if (id == 0 || showSecondSpectrum)
     update();
 }
@@ -80,15 +71,12 @@ void SpectrumPreview::setShowSecondSpectrum(bool value)
 SpectrumPreview::LikenessScore SpectrumPreview::getLikenessRating()
 {
   LikenessScore score;
-  double mfccs[2][WaveformAnalyzer::numCoefficients];
-  score.mse = WaveformAnalyzer::calculateMSE(waveforms);
-  score.fft = WaveformAnalyzer::calculateRMSE(spectrum);
-  WaveformAnalyzer::calculateMFCCs(spectrum[0], mfccs[0]);
-  WaveformAnalyzer::calculateMFCCs(spectrum[1], mfccs[1]);
-  score.mfcc = WaveformAnalyzer::calculateEuclideanDistance(mfccs[0], mfccs[1]);
-  score.dtw = WaveformAnalyzer::calculateDTW(mfccs[0], mfccs[1]);
-  score.cos = WaveformAnalyzer::calculateCosineDistance(mfccs[0], mfccs[1]);
-  WaveformAnalyzer::calculateAmplitudeShiftRating(waveforms, &score.avgAmp, &score.maxAmp);
+  score.mse = WaveformAnalyzer::calculateMSE(features[0].waveform, features[1].waveform);
+  score.fft = WaveformAnalyzer::calculateRMSE(features[0].spectrum, features[1].spectrum);
+  score.mfcc = WaveformAnalyzer::calculateEuclideanDistance(features[0].mfccs, features[1].mfccs);
+  score.dtw = WaveformAnalyzer::calculateDTW(features[0].mfccs, features[1].mfccs);
+  score.cos = WaveformAnalyzer::calculateCosineDistance(features[0].mfccs, features[1].mfccs);
+  WaveformAnalyzer::calculateAmplitudeShiftRating(features[0], features[1], &score.avgAmp, &score.maxAmp);
   score.likeness = WaveformAnalyzer::calculateLikenessRating(score.mse, score.fft, score.mfcc, score.dtw, score.cos, score.avgAmp, score.maxAmp);
   return score;
 }
@@ -120,19 +108,6 @@ void SpectrumPreview::setZoomLevel(int value)
   update();
 }
 
-void SpectrumPreview::normalizeSpectrum(std::complex<double> *in, double *out)
-{
-  double max = 0.0;
-  for (int i = 0; i < 4097; ++i)
-  {
-    out[i] = std::abs(in[i]);
-    if (out[i] > max)
-      max = out[i];
-  }
-  for (int i = 0; i < 4097; ++i)
-    out[i] /= max;
-}
-
 void SpectrumPreview::mousePressEvent(QMouseEvent *event)
 {
   int scaledWidth = (4097 - width()) * zoom / 100 + width();
@@ -142,9 +117,9 @@ void SpectrumPreview::mousePressEvent(QMouseEvent *event)
     QString text;
     int index = (event->pos().x() + hOffset) * 4097 / scaledWidth;
     double freq = index * 8000.0 / 8192.0;
-    text = QString("%1Hz: %2").arg(freq, 0, 'f', 2).arg(spectrum[0][index], 0, 'f', 3);
+    text = QString("%1Hz: %2").arg(freq, 0, 'f', 2).arg(features[0].spectrum[index], 0, 'f', 3);
     if (showSecondSpectrum)
-      text += QString(" - %1").arg(spectrum[1][index], 0, 'f', 3);
+      text += QString(" - %1").arg(features[1].spectrum[index], 0, 'f', 3);
     QToolTip::showText(mapToGlobal(event->pos()), text, this);
     showCursorPoint = true;
     update();
@@ -161,9 +136,9 @@ void SpectrumPreview::mouseMoveEvent(QMouseEvent *event)
     QString text;
     int index = (event->pos().x() + hOffset) * 4097 / scaledWidth;
     double freq = index * 8000.0 / 8192.0;
-    text = QString("%1Hz: %2").arg(freq, 0, 'f', 2).arg(spectrum[0][index], 0, 'f', 3);
+    text = QString("%1Hz: %2").arg(freq, 0, 'f', 2).arg(features[0].spectrum[index], 0, 'f', 3);
     if (showSecondSpectrum)
-      text += QString(" - %1").arg(spectrum[1][index], 0, 'f', 3);
+      text += QString(" - %1").arg(features[1].spectrum[index], 0, 'f', 3);
     QToolTip::showText(mapToGlobal(event->pos()), text, this);
     lastPos = event->pos();
     update();
@@ -201,13 +176,13 @@ void SpectrumPreview::paintEvent(QPaintEvent *event)
   painter.translate(-hOffset, 0);
   painter.setPen(QColor(0, 0, 255));
   for (int i = 0; i < 4097; ++i)
-    painter.drawLine(QLineF(i, height(), i, height() * (1.0 - spectrum[0][i])));
+    painter.drawLine(QLineF(i, height(), i, height() * (1.0 - features[0].spectrum[i])));
   if (showSecondSpectrum)
   {
     painter.setPen(QColor(255, 0, 0));
     painter.setOpacity(0.75);
     for (int i = 0; i < 4097; ++i)
-      painter.drawLine(QLineF(i, height(), i, height() * (1.0 - spectrum[1][i])));
+      painter.drawLine(QLineF(i, height(), i, height() * (1.0 - features[1].spectrum[i])));
   }
   if (showCursorPoint)
   {
@@ -215,10 +190,10 @@ void SpectrumPreview::paintEvent(QPaintEvent *event)
     painter.setPen(QPen(QColor(0, 0, 255), 2.0));
     painter.setBrush(Qt::NoBrush);
     painter.setOpacity(1.0);
-    painter.drawEllipse(QRectF(index - 3, height() * (1.0 - spectrum[0][index]) - 3, 7, 7));
+    painter.drawEllipse(QRectF(index - 3, height() * (1.0 - features[0].spectrum[index]) - 3, 7, 7));
     painter.setPen(QPen(QColor(255, 0, 0), 2.0));
     if (showSecondSpectrum)
-      painter.drawEllipse(QRectF(index - 3, height() * (1.0 - spectrum[1][index]) - 3, 7, 7));
+      painter.drawEllipse(QRectF(index - 3, height() * (1.0 - features[1].spectrum[index]) - 3, 7, 7));
   }
   painter.end();
 }
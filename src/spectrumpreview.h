@@ -27,6 +27,7 @@
 
 #include <QWidget>
 #include <complex>
+#include "waveformanalyzer.h"
 
 class SpectrumPreview : public QWidget
 {
@@ -45,9 +46,13 @@ class SpectrumPreview : public QWidget
     };
     SpectrumPreview(QWidget *parent=nullptr);
     ~SpectrumPreview();
+    //Meant for reference samples, their analysis is memoized by FeatureCache
     void setWaveformData(const uint8_t *data, int id);
+    //Same as setWaveformData() with the analysis already done (see PreviewRenderer)
+    void setAnalyzedData(const WaveformAnalyzer::Features &features, int id);
     void setShowSecondSpectrum(bool value);
     LikenessScore getLikenessRating();
+    const WaveformAnalyzer::Features &getFeatures(int id) const {return features[id];}
   signals:
     void rangeChanged(int min, int max);
     void hOffsetChanged(int value);
@@ -55,14 +60,12 @@ class SpectrumPreview : public QWidget
     void setHOffset(int value);
     void setZoomLevel(int value);
   private:
-    void normalizeSpectrum(std::complex<double> *in, double *out);
     void mousePressEvent(QMouseEvent *event);
     void mouseMoveEvent(QMouseEvent *event);
     void mouseReleaseEvent(QMouseEvent *event);
     void paintEvent(QPaintEvent *event);
     QPoint lastPos;
-    double waveforms[2][8192];
-    double spectrum[2][4097];
+    WaveformAnalyzer::Features features[2];
     int zoom;
     int hOffset;
     bool showSecondSpectrum;
@@ -0,0 +1,110 @@
+/**********************************************************************************
+ * MIT License                                                                    *
+ *                                                                                *
+ * Copyright (c) 2023 Justin (tuxinator2009) Davis                                *
+ *                                                                                *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy   *
+ * of this software and associated documentation files (the "Software"), to deal  *
+ * in the Software without restriction, including without limitation the rights   *
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+ * copies of the Software, and to permit persons to whom the Software is          *
+ * furnished to do so, subject to the following conditions:                       *
+ *                                                                                *
+ * The above copyright notice and this permission notice shall be included in all *
+ * copies or substantial portions of the Software.                                *
+ *                                                                                *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+ * SOFTWARE.                                                                      *
+ **********************************************************************************/
+
+
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+//Lock-free queue for exactly one producer thread and one consumer thread. Neither side ever blocks or
+//allocates, push/write fail (or write less) when the queue is full and pop/read when it is empty.
+//Capacity must be a power of two.
+template<class T, size_t Capacity> class SPSCQueue
+{
+  static_assert((Capacity & (Capacity - 1)) == 0, "SPSCQueue capacity must be a power of two");
+  public:
+    SPSCQueue() : _head(0), _tail(0), _discard(0) {}
+    //Producer side
+    bool push(const T &value)
+    {
+      size_t tail = _tail.load(std::memory_order_relaxed);
+      if (tail - _head.load(std::memory_order_acquire) == Capacity)
+        return false;
+      _items[tail & MASK] = value;
+      _tail.store(tail + 1, std::memory_order_release);
+      return true;
+    }
+    size_t write(const T *values, size_t count)
+    {
+      size_t tail = _tail.load(std::memory_order_relaxed);
+      size_t space = Capacity - (tail - _head.load(std::memory_order_acquire));
+      if (count > space)
+        count = space;
+      for (size_t i = 0; i < count; ++i)
+        _items[(tail + i) & MASK] = values[i];
+      _tail.store(tail + count, std::memory_order_release);
+      return count;
+    }
+    //Everything written so far is skipped by the consumer's next pop/read
+    void discard()
+    {
+      _discard.store(_tail.load(std::memory_order_relaxed), std::memory_order_release);
+    }
+    //Consumer side
+    bool pop(T &value)
+    {
+      size_t head = consumerHead();
+      if (head == _tail.load(std::memory_order_acquire))
+        return false;
+      value = _items[head & MASK];
+      _head.store(head + 1, std::memory_order_release);
+      return true;
+    }
+    size_t read(T *values, size_t count)
+    {
+      size_t head = consumerHead();
+      size_t available = _tail.load(std::memory_order_acquire) - head;
+      if (count > available)
+        count = available;
+      for (size_t i = 0; i < count; ++i)
+        values[i] = _items[(head + i) & MASK];
+      _head.store(head + count, std::memory_order_release);
+      return count;
+    }
+    //Either side, exact for the calling thread's own end
+    size_t size() const {return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire);}
+    bool empty() const {return size() == 0;}
+  private:
+    static constexpr size_t MASK = Capacity - 1;
+    size_t consumerHead()
+    {
+      size_t head = _head.load(std::memory_order_relaxed);
+      size_t discard = _discard.load(std::memory_order_acquire);
+      if ((std::ptrdiff_t)(discard - head) > 0)
+      {
+        head = discard;
+        _head.store(head, std::memory_order_release);
+      }
+      return head;
+    }
+    T _items[Capacity];
+    alignas(64) std::atomic<size_t> _head;
+    alignas(64) std::atomic<size_t> _tail;
+    alignas(64) std::atomic<size_t> _discard;
+};
+
+#endif //SPSCQUEUE_H
@@ -28,6 +28,8 @@ SOURCES += \
         CHeaderParser/cheaderparser.cpp \
         CHeaderParser/cheadervalue.cpp \
         cheaderview.cpp \
+        featurecache.cpp \
+        fmplayer.cpp \
         fmproject.cpp \
         fmsong.cpp \
         FMSource.cpp \
@@ -36,13 +38,18 @@ SOURCES += \
         main.cpp \
         mainwindow.cpp \
         newinstrument.cpp \
+        patchfitter.cpp \
         patterneditor.cpp \
+        previewrenderer.cpp \
         songeditor.cpp \
+        songexporter.cpp \
+        songrenderer.cpp \
         spectrumpreview.cpp \
         undo.cpp \
         virtualpiano.cpp \
         waveformanalyzer.cpp \
-        waveformpreview.cpp
+        waveformpreview.cpp \
+        wavwriter.cpp
 
 HEADERS += \
         CHeaderParser/cheaderarray.h \
@@ -50,6 +57,8 @@ HEADERS += \
         CHeaderParser/cheaderparser.h \
         CHeaderParser/cheadervalue.h \
         cheaderview.h \
+        featurecache.h \
+        fmplayer.h \
         fmproject.h \
         fmsong.h \
         FMSource.h \
@@ -58,13 +67,19 @@ HEADERS += \
         mainwindow.h \
         newinstrument.h \
         notespinbox.h \
+        patchfitter.h \
         patterneditor.h \
+        previewrenderer.h \
         songeditor.h \
+        songexporter.h \
+        songrenderer.h \
+        spscqueue.h \
         spectrumpreview.h \
         undo.h \
         virtualpiano.h \
         waveformanalyzer.h \
-        waveformpreview.h
+        waveformpreview.h \
+        wavwriter.h
 
 FORMS += \
         cheaderview.ui \
@@ -1,29 +1,73 @@
-#include <cstdio>
-#include <cstdlib>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "waveformAnalysis.h"
+
+//Compares every file with itself and with every other file and prints the scores as CSV, in the same
+//format and order as running waveformAnalysis in batch mode on each pair. Features are computed once
+//per file and pairs are scored on all cores, one row of the matrix at a time.
+//Usage: analyze [-j threads] file1.raw file2.raw [file3.raw] [...]
+
+template<typename Function> void parallelFor(int count, int numThreads, Function function)
+{
+  std::atomic<int> next(0);
+  std::vector<std::thread> threads;
+  auto worker = [&]() {
+    for (int i = next++; i < count; i = next++)
+      function(i);
+  };
+  for (int i = 1; i < numThreads; ++i)
+    threads.emplace_back(worker);
+  worker();
+  for (std::thread &thread : threads)
+    thread.join();
+}
 
 int main(int argc, char *argv[])
 {
-  if (argc < 4)
+  int numThreads = std::thread::hardware_concurrency();
+  int first = 1;
+  if (argc > 2 && strcmp(argv[1], "-j") == 0)
   {
-    printf("usage: %s waveformAnalyzer file1.raw file2.raw [file3.raw] [...]\n", argv[0]);
+    numThreads = atoi(argv[2]);
+    first = 3;
+  }
+  if (numThreads < 1)
+    numThreads = 1;
+  if (argc - first < 2)
+  {
+    printf("usage: %s [-j threads] file1.raw file2.raw [file3.raw] [...]\n", argv[0]);
     return -1;
   }
-  printf("file1,file2,MSE,FFT,MFCC,DTW,COS,AVG,MAX,MAX DTW\n");
-  fflush(stdout);
-  for (int i = 2; i < argc; ++i)
+  int numFiles = argc - first;
+  char **files = argv + first;
+  std::vector<Features> features(numFiles);
+  std::vector<char> loaded(numFiles);
+  //Row i holds the pairs (i, i) to (i, numFiles - 1)
+  std::vector<Scores> scores((size_t)numFiles * (numFiles + 1) / 2);
+  auto row = [numFiles](int i) {return (size_t)i * numFiles - (size_t)i * (i - 1) / 2;};
+  
+  parallelFor(numFiles, numThreads, [&](int i) {
+    loaded[i] = loadFeatures(files[i], &features[i]);
+  });
+  for (int i = 0; i < numFiles; ++i)
   {
-    char cmd[512];
-    sprintf(cmd, "%s \"%s\" \"%s\" batch", argv[1], argv[i], argv[i]);
-    system(cmd);
+    if (!loaded[i])
+      return -1;
   }
-  for (int i = 2; i < argc - 1; ++i)
+  //Rows get shorter towards the end, handing them out one at a time keeps the threads balanced
+  parallelFor(numFiles, numThreads, [&](int i) {
+    for (int j = i; j < numFiles; ++j)
+      compareFeatures(features[i], features[j], &scores[row(i) + j - i]);
+  });
+  
+  printf("file1,file2,MSE,FFT,MFCC,DTW,COS,AVG,MAX,MAX DTW\n");
+  for (int i = 0; i < numFiles; ++i)
+    printScores(files[i], files[i], scores[row(i)]);
+  for (int i = 0; i < numFiles - 1; ++i)
   {
-    for (int j = i + 1; j < argc; ++j)
-    {
-      char cmd[512];
-      sprintf(cmd, "%s \"%s\" \"%s\" batch", argv[1], argv[i], argv[j]);
-      system(cmd);
-    }
+    for (int j = i + 1; j < numFiles; ++j)
+      printScores(files[i], files[j], scores[row(i) + j - i]);
   }
   return 0;
 }
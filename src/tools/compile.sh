@@ -1,6 +1,6 @@
 #!/bin/sh
 CXX_FLAGS="-Wall -g -std=gnu++1z"
-LIBS="-lm"
+LIBS="-lm -pthread"
 CXX="g++"
 for filename in *.cpp; do
 	[ -e "$filename" ] || continue
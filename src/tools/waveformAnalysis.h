@@ -0,0 +1,514 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <complex>
+#include <initializer_list>
+#include <cmath>
+#include <cstring>
+
+const int numSamples = 8192;
+const int sampleRate = 8000;
+const int numMelFilters = 26;  // Number of Mel filters
+const int numCoefficients = 13;  // Number of MFCC coefficients to keep
+const int numFrequencies = numSamples / 2 + 1;
+const double mseWeight = 1.0;//0.5;
+const double fftWeight = 1.0;//0.3;
+const double mfccWeight = 1.0;//0.4;
+const double dtwWeight = 1.0;//0.8;
+const double cosWeight = 1.0;//0.2;
+const double avgAmpWeight = 1.0;
+const double maxAmpWeight = 1.0;
+const double power = 8.0;
+const double baseFrequency = 261.6;
+const int window = (sampleRate / baseFrequency) * 1.5;
+const int windowStep = (sampleRate / baseFrequency) / 2.0;
+const int numWindows = (numSamples - window) / windowStep + 1;
+
+//Real input FFT done as a complex FFT of half the size on the even (real) and odd (imaginary) samples,
+//followed by a split step that separates their spectra. The half size transform is 4^6 points and runs on
+//radix-4 butterflies. Twiddles and the digit reversal are computed once with cos/sin so no rounding error
+//accumulates. Only the real parts of data are read, the whole spectrum is written back.
+const int fftSize = numSamples / 2;
+int fftReversal[fftSize];
+std::complex<double> fftTwiddles[3][fftSize];
+std::complex<double> fftSplit[fftSize + 1];
+
+void initFFT()
+{
+  for (int i = 0; i < fftSize; ++i)
+  {
+    int reversed = 0;
+    for (int n = i, bits = 1; bits < fftSize; bits <<= 2, n >>= 2)
+      reversed = (reversed << 2) | (n & 3);
+    fftReversal[i] = reversed;
+    //Stage with quarters length apart uses twiddle m * k * (fftSize / (4 * length))
+    for (int m = 0; m < 3; ++m)
+      fftTwiddles[m][i] = std::polar(1.0, -2.0 * M_PI * (m + 1) * i / fftSize);
+  }
+  for (int k = 0; k <= fftSize; ++k)
+    fftSplit[k] = std::polar(1.0, -2.0 * M_PI * k / numSamples);
+}
+
+void fft(std::complex<double>* data)
+{
+  std::complex<double> z[fftSize];
+  //Static initialization runs once even when several threads get here first
+  static bool initialized = (initFFT(), true);
+  (void)initialized;
+  for (int i = 0; i < fftSize; ++i)
+    z[fftReversal[i]] = std::complex<double>(data[2 * i].real(), data[2 * i + 1].real());
+  
+  // Radix-4 decimation in time
+  for (int length = 1; length < fftSize; length <<= 2)
+  {
+    int stride = fftSize / (4 * length);
+    for (int group = 0; group < fftSize; group += 4 * length)
+    {
+      for (int k = 0; k < length; ++k)
+      {
+        std::complex<double> *x = z + group + k;
+        std::complex<double> a0 = x[0];
+        std::complex<double> a1 = x[length] * fftTwiddles[0][k * stride];
+        std::complex<double> a2 = x[2 * length] * fftTwiddles[1][k * stride];
+        std::complex<double> a3 = x[3 * length] * fftTwiddles[2][k * stride];
+        std::complex<double> b0 = a0 + a2;
+        std::complex<double> b1 = a0 - a2;
+        std::complex<double> b2 = a1 + a3;
+        std::complex<double> b3 = (a1 - a3) * std::complex<double>(0.0, -1.0);
+        x[0] = b0 + b2;
+        x[length] = b1 + b3;
+        x[2 * length] = b0 - b2;
+        x[3 * length] = b1 - b3;
+      }
+    }
+  }
+  
+  // Split step, the upper half of the spectrum mirrors the lower half
+  for (int k = 0; k <= fftSize; ++k)
+  {
+    std::complex<double> zk = z[k % fftSize];
+    std::complex<double> zn = std::conj(z[(fftSize - k) % fftSize]);
+    std::complex<double> even = (zk + zn) * 0.5;
+    std::complex<double> odd = (zk - zn) * std::complex<double>(0.0, -0.5);
+    data[k] = even + fftSplit[k] * odd;
+  }
+  for (int k = fftSize + 1; k < numSamples; ++k)
+    data[k] = std::conj(data[numSamples - k]);
+}
+
+void normalize(std::complex<double> *data, int size)
+{
+  double max = 0.0;
+  for (int i = 0; i < size; ++i)
+  {
+    if (std::abs(data[i]) > max)
+      max = std::abs(data[i]);
+  }
+  for (int i = 0; i < size; ++i)
+    data[i] /= max;
+}
+
+void normalize(double *data, int size)
+{
+  double max = 0.0;
+  for (int i = 0; i < size; ++i)
+  {
+    if (std::abs(data[i]) > max)
+      max = std::abs(data[i]);
+  }
+  for (int i = 0; i < size; ++i)
+    data[i] /= max;
+}
+
+double calculateRMSE(const std::complex<double> *data0, const std::complex<double> *data1, int size)
+{
+  double sumSquaredDiff = 0.0;
+  for (int i = 0; i < size; ++i)
+  {
+    double diff = std::abs(data0[i] - data1[i]);
+    sumSquaredDiff += diff * diff;
+  }
+  double meanSquaredDiff = sumSquaredDiff / size;
+  double rmse = std::sqrt(meanSquaredDiff);
+  return rmse;
+}
+
+void fillMelFilterbank(double melFilterbank[numMelFilters][numFrequencies])
+{
+  double minMel = 2595 * log10(1 + 0 / 700);  // Mel scale at lowest frequency
+  double maxMel = 2595 * log10(1 + (sampleRate / 2) / 700);  // Mel scale at Nyquist frequency
+  
+  // Create evenly spaced center frequencies on the Mel scale
+  double centerFrequencies[numMelFilters];
+  for (int i = 0; i < numMelFilters; ++i)
+  {
+    double mel = minMel + (maxMel - minMel) * (i + 1) / (numMelFilters + 1);
+    centerFrequencies[i] = 700 * (pow(10, mel / 2595) - 1);
+    for (int j = 0; j < numFrequencies; ++j)
+      melFilterbank[i][j] = 0.0;
+  }
+  
+  // Create the Mel filterbank matrix
+  for (int i = 0; i < numMelFilters; ++i)
+  {
+    for (int j = 1; j < numFrequencies; ++j)
+    {
+      double lowerFreq = (j - 1) * sampleRate / numSamples;
+      double centerFreq = centerFrequencies[i];
+      double upperFreq = (j + 1) * sampleRate / numSamples;
+      if (lowerFreq <= centerFreq && centerFreq <= upperFreq)
+      {
+        if (centerFreq <= lowerFreq + 1)
+          melFilterbank[i][j] = (centerFreq - lowerFreq) / (upperFreq - lowerFreq);
+        else if (centerFreq >= upperFreq - 1)
+          melFilterbank[i][j] = (upperFreq - centerFreq) / (upperFreq - lowerFreq);
+        else
+          melFilterbank[i][j] = 1;
+      }
+    }
+  }
+}
+
+void applyDCT(const double *input, double *output)
+{
+  for (int i = 1; i < numCoefficients + 1; ++i)
+  {
+    double sum = 0.0;
+    for (int j = 0; j < numMelFilters; ++j)
+    {
+      double coefficient = input[j];
+      double angle = M_PI * (j + 0.5) * i / numMelFilters;
+      sum += coefficient * std::cos(angle);
+    }
+    output[i - 1] = sum;
+  }
+}
+
+void calculateMFCCs(const std::complex<double> *fftMagnitudes, double *mfccs)
+{
+  double melFilterbank[numMelFilters][numFrequencies];
+  double melEnergies[numMelFilters];
+  
+  // Define the Mel filterbank coefficients (replace with your own)
+  fillMelFilterbank(melFilterbank);
+  // Apply the Mel filterbank to FFT magnitudes
+  for (int i = 0; i < numMelFilters; ++i)
+  {
+    melEnergies[i] = 0.0;
+    for (int j = 0; j < numFrequencies; ++j)
+    {
+      melEnergies[i] += melFilterbank[i][j] * std::abs(fftMagnitudes[j]);
+    }
+  }
+  
+  // Take the logarithm of Mel energies
+  for (int i = 0; i < numMelFilters; ++i)
+    melEnergies[i] = std::log(melEnergies[i]);
+  
+  // Apply Discrete Cosine Transform (DCT) to get MFCC coefficients
+  applyDCT(melEnergies, mfccs);
+}
+
+double calculateEuclideanDistance(const double *mfccSet1, const double *mfccSet2)
+{
+  double sumSquaredDifferences = 0.0;
+  for (size_t i = 0; i < numCoefficients; ++i)
+  {
+    double difference = mfccSet1[i] - mfccSet2[i];
+    sumSquaredDifferences += difference * difference;
+  }
+  return std::sqrt(sumSquaredDifferences);
+}
+
+/*double calculateDTW(const double *sequence1, const double *sequence2, double *max)
+{
+  double dtw[numCoefficients][numCoefficients];
+  *max = 0.0;
+  for (int i = 0; i < numCoefficients; ++i)
+  {
+    for (int j = 0; j < numCoefficients; ++j)
+    {
+      double distance = std::abs(sequence1[i] - sequence2[j]);
+      dtw[i][j] = distance;
+      if (i > 0 || j > 0)
+      {
+        double l = (i > 0) ? dtw[i - 1][j]:INFINITY;
+        double m = (j > 0) ? dtw[i][j - 1]:INFINITY;
+        double r = (i > 0 && j > 0) ? dtw[i - 1][j - 1]:INFINITY;
+        dtw[i][j] += std::min(l, std::min(m, r));
+      }
+      if (dtw[i][j] > *max)
+        *max = dtw[i][j];
+    }
+  }
+  return 1.0 - dtw[numCoefficients - 1][numCoefficients - 1];
+}*/
+
+double euclideanDistance(double mfcc1, double mfcc2)
+{
+  double diff = mfcc1 - mfcc2;
+  return diff * diff;
+}
+
+double calculateDTW(const double *sequence1, const double *sequence2, double *max)
+{
+  // Initialize DTW matrix
+  double dtw[numCoefficients+1][numCoefficients+1] = {};
+  *max = 0.0;
+  for (size_t i = 1; i <= numCoefficients; ++i)
+  {
+    for (size_t j = 1; j <= numCoefficients; ++j)
+    {
+      double cost = euclideanDistance(sequence1[i - 1], sequence2[j - 1]);
+      dtw[i][j] = cost + std::min(dtw[i - 1][j], std::min(dtw[i][j - 1], dtw[i - 1][j - 1]));
+      if (dtw[i][j] > *max)
+        *max = dtw[i][j];
+    }
+  }
+  
+  // Return the DTW distance between the sequences
+  return dtw[numCoefficients][numCoefficients];
+}
+
+double dotProduct(const double *a, const double *b)
+{
+  double sum = 0.0;
+  for (size_t i = 0; i < numCoefficients; ++i) {
+    sum += a[i] * b[i];
+  }
+  return sum;
+}
+
+double magnitude(const double *v)
+{
+  double sum = 0.0;
+  for (int i = 0; i < numCoefficients; ++i)
+    sum += v[i] * v[i];
+  return std::sqrt(sum);
+}
+
+double calculateCosineDistance(const double *sequence1, const double *sequence2)
+{
+  double dot = 0.0;
+  double mag1 = 0.0;
+  double mag2 = 0.0;
+  for (int i = 0; i < numCoefficients; ++i)
+  {
+    dot += sequence1[i] * sequence2[i];
+    mag1 += sequence1[i] * sequence1[i];
+    mag2 += sequence2[i] * sequence2[i];
+  }
+  return 1.0 - (dot / (std::sqrt(mag1 * mag2)));
+  
+  /*double dot = dotProduct(sequence1, sequence2);
+  double mag1 = magnitude(sequence1);
+  double mag2 = magnitude(sequence2);
+  if (mag1 == 0.0 || mag2 == 0.0)
+    return -1.0;  // Invalid input
+  return 1.0 - (dot / (mag1 * mag2));*/
+}
+
+/*double cosine_similarity(double *A, double *B, unsigned int Vector_Length)
+{
+  double dot = 0.0, denom_a = 0.0, denom_b = 0.0 ;
+  for(unsigned int i = 0u; i < Vector_Length; ++i) {
+    dot += A[i] * B[i] ;
+    denom_a += A[i] * A[i] ;
+    denom_b += B[i] * B[i] ;
+  }
+  return dot / (sqrt(denom_a) * sqrt(denom_b)) ;
+}*/
+
+//Samples are real so the distance is the same as the magnitude of their complex difference
+double calculateMSE(const double *input0, const double *input1, double *max)
+{
+  double sum = 0.0;
+  *max = 0.0001;
+  for (int i = 0; i < numSamples; ++i)
+  {
+    double distance = std::abs(input0[i] - input1[i]);
+    if (distance * distance > *max)
+      *max = distance * distance;
+    sum += distance * distance;
+  }
+  *max = 1.0;//Try with maximum possible difference between two samples
+  sum /= numSamples;
+  return std::sqrt(sum);
+}
+
+//Average and peak level of each window, which only depend on one file
+struct AmplitudeEnvelope
+{
+  double average[numWindows];
+  double max[numWindows];
+};
+
+void calculateAmplitudeEnvelope(const double *input, AmplitudeEnvelope *envelope)
+{
+  for (int i = 0, w = 0; i < numSamples; i += windowStep, ++w)
+  {
+    double sum = 0.0;
+    double max = 0.0;
+    if (i + window >= numSamples)
+      break;
+    for (int j = i; j < i + window && j < numSamples; ++j)
+    {
+      if (input[j] > max)
+        max = std::abs(input[j]);
+      sum += input[j];
+    }
+    envelope->average[w] = sum / window;
+    envelope->max[w] = max;
+  }
+}
+
+void calculateAmplitudeShiftRating(const AmplitudeEnvelope &envelope0, const AmplitudeEnvelope &envelope1, double *avg, double *max)
+{
+  double avgSum = 0.0;
+  double maxSum = 0.0;
+  for (int w = 0; w < numWindows; ++w)
+  {
+    avgSum += std::abs(envelope1.average[w] - envelope0.average[w]);
+    maxSum += std::abs(envelope1.max[w] - envelope0.max[w]);
+  }
+  avgSum /= numWindows;
+  maxSum /= numWindows;
+  *avg = avgSum;
+  *max = maxSum;
+}
+
+// Calculate weighted average given a list of value-weight pairs
+double calculateWeightedAverage(std::initializer_list<std::pair<double, double>> valueWeightPairs)
+{
+  double weightedSum = 0.0;
+  double totalWeight = 0.0;
+  double min = 1.0 / (valueWeightPairs.begin()->first + 0.0001);
+  double max = min;
+  double range;
+  
+  
+  //First we get the min and max of the inverted values
+  for (const auto& pair : valueWeightPairs)
+  {
+    min = std::min(min, 1.0 / (pair.first + 0.0001));
+    max = std::max(max, 1.0 / (pair.first + 0.0001));
+  }
+  range = max - min;
+  if (range < 0.0001)
+    range = 1.0;
+  
+  //Next we invert the values and scale them from the range of min - max to 0 - 1
+  for (const auto& pair : valueWeightPairs)
+  {
+    double value = 1.0 / (pair.first + 0.0001);
+    double result = (value - min) / range;
+    //double value = 1.0 - std::min(pair.first, 0.7);
+    //double result = std::min(-std::log(value), 1.0);
+    weightedSum += result * pair.second;
+    totalWeight += pair.second;
+  }
+  
+  if (totalWeight == 0.0)
+    return 0.0; // Avoid division by zero
+  
+  return weightedSum / totalWeight;
+}
+
+bool loadFile(const char *location, std::complex<double> *samples)
+{
+  FILE *file = fopen(location, "rb");
+  uint8_t data[numSamples];
+  if (!file)
+  {
+    printf("Error: failed to open first file\n");
+    perror("Reason:");
+    return false;
+  }
+  //Initialize all values to silence (0x80)
+  for (int i = 0; i < numSamples; ++i)
+    data[i] = 0x80;
+  //Read at most 8000 samples (remainder will be padded with silence and overage will get truncated)
+  fread(data, 1, 8000, file);
+  fclose(file);
+  //Convert raw unsigned 8-bit samples to doubles
+  for (int i = 0; i < numSamples; ++i)
+    samples[i] = data[i] / 128.0 - 1.0;
+  normalize(samples, numSamples);
+  return true;
+}
+
+void printFileName(const char *location)
+{
+  int start = 0;
+  while (location[start] != '\0')
+    ++start;
+  while (start > 0)
+  {
+    if (location[start] == '/')
+      break;
+    --start;
+  }
+  ++start;
+  printf("%s", location + start);
+}
+
+//Everything the likeness scores need from one file. Computing it once per file lets a batch compare
+//every pair without loading or transforming a file more than once.
+struct Features
+{
+  double samples[numSamples];//Normalized waveform
+  std::complex<double> spectrum[numFrequencies];//Normalized lower half of the spectrum
+  double mfccs[numCoefficients];//Normalized MFCCs
+  AmplitudeEnvelope envelope;
+};
+
+struct Scores
+{
+  double mseLikeness;
+  double fftLikeness;
+  double mfccLikeness;
+  double dtwLikeness;
+  double cosLikeness;
+  double avgAmpLikeness;
+  double maxAmpLikeness;
+  double maxDTW;
+};
+
+bool loadFeatures(const char *location, Features *features)
+{
+  std::complex<double> samples[numSamples];
+  if (!loadFile(location, samples))
+    return false;
+  for (int i = 0; i < numSamples; ++i)
+    features->samples[i] = samples[i].real();
+  calculateAmplitudeEnvelope(features->samples, &features->envelope);
+  fft(samples);
+  normalize(samples, numFrequencies);
+  memcpy(features->spectrum, samples, sizeof(features->spectrum));
+  calculateMFCCs(features->spectrum, features->mfccs);
+  normalize(features->mfccs, numCoefficients);
+  return true;
+}
+
+void compareFeatures(const Features &features0, const Features &features1, Scores *scores)
+{
+  double maxMSE;
+  double maxCosDistance = 2.0;
+  scores->mseLikeness = calculateMSE(features0.samples, features1.samples, &maxMSE) / maxMSE;
+  calculateAmplitudeShiftRating(features0.envelope, features1.envelope, &scores->avgAmpLikeness, &scores->maxAmpLikeness);
+  scores->fftLikeness = calculateRMSE(features0.spectrum, features1.spectrum, numFrequencies);
+  scores->mfccLikeness = calculateEuclideanDistance(features0.mfccs, features1.mfccs) / (2 * std::sqrt(numCoefficients));
+  scores->dtwLikeness = calculateDTW(features0.mfccs, features1.mfccs, &scores->maxDTW);
+  scores->dtwLikeness /= scores->maxDTW;
+  scores->cosLikeness = calculateCosineDistance(features0.mfccs, features1.mfccs) / maxCosDistance;
+}
+
+void printScores(const char *location0, const char *location1, const Scores &scores)
+{
+  printFileName(location0);
+  printf(",");
+  printFileName(location1);
+  printf(",%f,%f,%f,%f,%f,%f,%f,%f\n", scores.mseLikeness, scores.fftLikeness, scores.mfccLikeness, scores.dtwLikeness, scores.cosLikeness, scores.avgAmpLikeness, scores.maxAmpLikeness, scores.maxDTW);
+}
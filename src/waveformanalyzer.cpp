@@ -26,44 +26,213 @@
 #include <cstdint>
 #include <complex>
 #include <initializer_list>
+#include <algorithm>
 #include <cmath>
+#include <vector>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
 #include "waveformanalyzer.h"
 
-void WaveformAnalyzer::fft(std::complex<double> data[numSamples])
+namespace
 {
-  // Bit-reverse swapping
-  int j = numSamples >> 1;
-  for (int i = 1; i < numSamples - 1; i++)
+  //Lanes of doubles for the FFT butterflies, the kernel is written once as a template (like FMSynth::Simd)
+  //and runs two butterflies at a time with SSE2, the scalar lane handles what is left over
+  struct Double1
   {
-    if (i < j)
-      std::swap(data[j], data[i]);
-    int k = numSamples >> 1;
-    while (j >= k)
+    static constexpr int width = 1;
+    double v;
+    static inline Double1 load(const double *p) {return {*p};}
+    inline void store(double *p) const {*p = v;}
+    friend inline Double1 operator+(Double1 a, Double1 b) {return {a.v + b.v};}
+    friend inline Double1 operator-(Double1 a, Double1 b) {return {a.v - b.v};}
+    friend inline Double1 operator*(Double1 a, Double1 b) {return {a.v * b.v};}
+  };
+  
+#if defined(__SSE2__) || defined(_M_X64)
+  struct Double2
+  {
+    static constexpr int width = 2;
+    __m128d v;
+    static inline Double2 load(const double *p) {return {_mm_loadu_pd(p)};}
+    inline void store(double *p) const {_mm_storeu_pd(p, v);}
+    friend inline Double2 operator+(Double2 a, Double2 b) {return {_mm_add_pd(a.v, b.v)};}
+    friend inline Double2 operator-(Double2 a, Double2 b) {return {_mm_sub_pd(a.v, b.v)};}
+    friend inline Double2 operator*(Double2 a, Double2 b) {return {_mm_mul_pd(a.v, b.v)};}
+  };
+  using WideDouble = Double2;
+#else
+  using WideDouble = Double1;
+#endif
+  
+  //A real FFT of numSamples points is done as a complex FFT of half the size on the even (real) and odd
+  //(imaginary) samples, followed by a split step that separates the two spectra. The half size transform
+  //is 4^6 points so it runs entirely on radix-4 butterflies. Data is kept as separate real and imaginary
+  //arrays, twiddles are stored per stage in butterfly order and every table entry is computed directly
+  //with cos/sin, nothing accumulates rounding error.
+  struct FFTTables
+  {
+    static constexpr int size = WaveformAnalyzer::numSamples / 2;
+    static constexpr int numTwiddles = (size - 1) / 3;//1 + 4 + ... + size / 4, one per butterfly of each stage
+    FFTTables()
     {
-      j -= k;
-      k >>= 1;
+      int offset = 0;
+      for (int i = 0; i < size; ++i)
+      {
+        //Base 4 digit reversal
+        int reversed = 0;
+        for (int n = i, bits = 1; bits < size; bits <<= 2, n >>= 2)
+          reversed = (reversed << 2) | (n & 3);
+        reversal[i] = reversed;
+      }
+      for (int length = 1; length < size; length <<= 2)
+      {
+        for (int k = 0; k < length; ++k)
+        {
+          for (int m = 0; m < 3; ++m)
+          {
+            double angle = -2.0 * M_PI * (m + 1) * k / (4 * length);
+            twiddleRe[m][offset + k] = std::cos(angle);
+            twiddleIm[m][offset + k] = std::sin(angle);
+          }
+        }
+        offset += length;
+      }
+      for (int k = 0; k < WaveformAnalyzer::numFrequencies; ++k)
+        split[k] = std::polar(1.0, -2.0 * M_PI * k / WaveformAnalyzer::numSamples);
     }
-    j += k;
+    int reversal[size];
+    double twiddleRe[3][numTwiddles];
+    double twiddleIm[3][numTwiddles];
+    std::complex<double> split[WaveformAnalyzer::numFrequencies];
+  };
+  
+  const FFTTables &fftTables()
+  {
+    static const FFTTables tables;
+    return tables;
   }
   
-  // Cooley-Tukey Decimation in Time FFT
-  for (int step = 1; step < numSamples; step <<= 1)
+  //Radix-4 decimation in time butterflies k...k+V::width-1 of a group, its four quarters are length apart
+  template<typename V> inline void butterfly(double *re, double *im, int length, const double *twiddleRe[3], const double *twiddleIm[3], int k)
+  {
+    V ar[4];
+    V ai[4];
+    ar[0] = V::load(re + k);
+    ai[0] = V::load(im + k);
+    for (int m = 1; m < 4; ++m)
+    {
+      V xr = V::load(re + k + m * length);
+      V xi = V::load(im + k + m * length);
+      V wr = V::load(twiddleRe[m - 1] + k);
+      V wi = V::load(twiddleIm[m - 1] + k);
+      ar[m] = xr * wr - xi * wi;
+      ai[m] = xr * wi + xi * wr;
+    }
+    V b0r = ar[0] + ar[2];
+    V b0i = ai[0] + ai[2];
+    V b1r = ar[0] - ar[2];
+    V b1i = ai[0] - ai[2];
+    V b2r = ar[1] + ar[3];
+    V b2i = ai[1] + ai[3];
+    //-i * (a1 - a3)
+    V b3r = ai[1] - ai[3];
+    V b3i = ar[3] - ar[1];
+    (b0r + b2r).store(re + k);
+    (b0i + b2i).store(im + k);
+    (b1r + b3r).store(re + k + length);
+    (b1i + b3i).store(im + k + length);
+    (b0r - b2r).store(re + k + 2 * length);
+    (b0i - b2i).store(im + k + 2 * length);
+    (b1r - b3r).store(re + k + 3 * length);
+    (b1i - b3i).store(im + k + 3 * length);
+  }
+  //The mel filterbank and DCT never change, they are built once on first use (thread safe, the preview
+  //renderer calls in from its own thread). Each filter only covers a couple of FFT bins so the filterbank
+  //keeps just the nonzero weights of every filter, applying it is a short dot product per filter.
+  struct MelTables
   {
-    double theta = -M_PI / step;
-    std::complex<double> w(1.0, 0.0);
-    std::complex<double> wn(std::cos(theta), std::sin(theta));
-    
-    for (int m = 0; m < step; m++)
+    MelTables()
     {
-      for (int k = m; k < numSamples; k += step << 1)
+      std::vector<double> dense(WaveformAnalyzer::numMelFilters * WaveformAnalyzer::numFrequencies);
+      double (*filterbank)[WaveformAnalyzer::numFrequencies] = (double(*)[WaveformAnalyzer::numFrequencies])dense.data();
+      WaveformAnalyzer::fillMelFilterbank(filterbank);
+      for (int i = 0; i < WaveformAnalyzer::numMelFilters; ++i)
       {
-        std::complex<double> t = w * data[k + step];
-        std::complex<double> u = data[k];
-        data[k] = u + t;
-        data[k + step] = u - t;
+        first[i] = 0;
+        offset[i] = weights.size();
+        for (int j = 0; j < WaveformAnalyzer::numFrequencies; ++j)
+        {
+          if (filterbank[i][j] == 0.0)
+            continue;
+          if (weights.size() == offset[i])
+            first[i] = j;
+          //Zeros between the first and last nonzero bin are kept so a filter is one contiguous range
+          while ((int)(weights.size() - offset[i]) < j - first[i])
+            weights.push_back(0.0);
+          weights.push_back(filterbank[i][j]);
+        }
+        count[i] = weights.size() - offset[i];
+      }
+      for (int i = 0; i < WaveformAnalyzer::numCoefficients; ++i)
+      {
+        for (int j = 0; j < WaveformAnalyzer::numMelFilters; ++j)
+          dct[i][j] = std::cos(M_PI * (j + 0.5) * (i + 1) / WaveformAnalyzer::numMelFilters);
       }
-      w *= wn;
     }
+    std::vector<double> weights;
+    size_t offset[WaveformAnalyzer::numMelFilters];
+    int first[WaveformAnalyzer::numMelFilters];
+    int count[WaveformAnalyzer::numMelFilters];
+    double dct[WaveformAnalyzer::numCoefficients][WaveformAnalyzer::numMelFilters];
+  };
+
+  const MelTables &melTables()
+  {
+    static const MelTables tables;
+    return tables;
+  }
+}
+
+void WaveformAnalyzer::fft(const double input[numSamples], std::complex<double> output[numFrequencies])
+{
+  constexpr int size = FFTTables::size;
+  const FFTTables &tables = fftTables();
+  double re[size];
+  double im[size];
+  int offset = 0;
+  
+  // Even samples become the real part and odd samples the imaginary part, in digit reversed order
+  for (int i = 0; i < size; ++i)
+  {
+    re[tables.reversal[i]] = input[2 * i];
+    im[tables.reversal[i]] = input[2 * i + 1];
+  }
+  
+  // Radix-4 decimation in time
+  for (int length = 1; length < size; length <<= 2)
+  {
+    const double *twiddleRe[3] = {tables.twiddleRe[0] + offset, tables.twiddleRe[1] + offset, tables.twiddleRe[2] + offset};
+    const double *twiddleIm[3] = {tables.twiddleIm[0] + offset, tables.twiddleIm[1] + offset, tables.twiddleIm[2] + offset};
+    for (int group = 0; group < size; group += 4 * length)
+    {
+      int k = 0;
+      for (; k + WideDouble::width <= length; k += WideDouble::width)
+        butterfly<WideDouble>(re + group, im + group, length, twiddleRe, twiddleIm, k);
+      for (; k < length; ++k)
+        butterfly<Double1>(re + group, im + group, length, twiddleRe, twiddleIm, k);
+    }
+    offset += length;
+  }
+  
+  // Split the spectra of the even and odd samples and combine them into the spectrum of the whole input
+  for (int k = 0; k < numFrequencies; ++k)
+  {
+    std::complex<double> z(re[k % size], im[k % size]);
+    std::complex<double> zn(re[(size - k) % size], -im[(size - k) % size]);
+    std::complex<double> even = (z + zn) * 0.5;
+    std::complex<double> odd = (z - zn) * std::complex<double>(0.0, -0.5);
+    output[k] = even + tables.split[k] * odd;
   }
 }
 
@@ -91,12 +260,44 @@ void WaveformAnalyzer::normalize(double *data, int size)
     data[i] /= max;
 }
 
-double WaveformAnalyzer::calculateRMSE(double data[2][numFrequencies])
+void WaveformAnalyzer::loadSamples(const uint8_t samples[sampleRate], double waveform[numSamples])
+{
+  for (int i = 0; i < sampleRate; ++i)
+    waveform[i] = samples[i] / 128.0 - 1.0;
+  for (int i = sampleRate; i < numSamples; ++i)
+    waveform[i] = 0.0;
+  normalize(waveform, numSamples);
+}
+
+void WaveformAnalyzer::analyzeSamples(const uint8_t samples[sampleRate], double waveform[numSamples], double spectrum[numFrequencies])
+{
+  std::complex<double> output[numFrequencies];
+  double max = 0.0;
+  loadSamples(samples, waveform);
+  fft(waveform, output);
+  for (int i = 0; i < numFrequencies; ++i)
+  {
+    spectrum[i] = std::abs(output[i]);
+    if (spectrum[i] > max)
+      max = spectrum[i];
+  }
+  for (int i = 0; i < numFrequencies; ++i)
+    spectrum[i] /= max;
+}
+
+void WaveformAnalyzer::analyzeFeatures(const uint8_t samples[sampleRate], Features *features)
+{
+  analyzeSamples(samples, features->waveform, features->spectrum);
+  calculateMFCCs(features->spectrum, features->mfccs);
+  calculateAmplitudeEnvelope(features->waveform, features->windowAverage, features->windowMax);
+}
+
+double WaveformAnalyzer::calculateRMSE(const double data1[numFrequencies], const double data2[numFrequencies])
 {
   double sumSquaredDiff = 0.0;
   for (int i = 0; i < numFrequencies; ++i)
   {
-    double diff = std::abs(data[0][i] - data[1][i]);
+    double diff = std::abs(data1[i] - data2[i]);
     sumSquaredDiff += diff * diff;
   }
   double meanSquaredDiff = sumSquaredDiff / numFrequencies;
@@ -142,34 +343,29 @@ void WaveformAnalyzer::fillMelFilterbank(double melFilterbank[numMelFilters][num
 
 void WaveformAnalyzer::applyDCT(const double *input, double *output)
 {
-  for (int i = 1; i < numCoefficients + 1; ++i)
+  const MelTables &tables = melTables();
+  for (int i = 0; i < numCoefficients; ++i)
   {
     double sum = 0.0;
     for (int j = 0; j < numMelFilters; ++j)
-    {
-      double coefficient = input[j];
-      double angle = M_PI * (j + 0.5) * i / numMelFilters;
-      sum += coefficient * std::cos(angle);
-    }
-    output[i - 1] = sum;
+      sum += input[j] * tables.dct[i][j];
+    output[i] = sum;
   }
 }
 
 void WaveformAnalyzer::calculateMFCCs(const double fftMagnitudes[numFrequencies], double mfccs[numCoefficients])
 {
-  double melFilterbank[numMelFilters][numFrequencies];
+  const MelTables &tables = melTables();
   double melEnergies[numMelFilters];
   
-  // Define the Mel filterbank coefficients (replace with your own)
-  fillMelFilterbank(melFilterbank);
-  // Apply the Mel filterbank to FFT magnitudes
+  // Apply the Mel filterbank to FFT magnitudes, only the bins each filter covers
   for (int i = 0; i < numMelFilters; ++i)
   {
+    const double *weights = tables.weights.data() + tables.offset[i];
+    const double *magnitudes = fftMagnitudes + tables.first[i];
     melEnergies[i] = 0.0;
-    for (int j = 0; j < numFrequencies; ++j)
-    {
-      melEnergies[i] += melFilterbank[i][j] * std::abs(fftMagnitudes[j]);
-    }
+    for (int j = 0; j < tables.count[i]; ++j)
+      melEnergies[i] += weights[j] * std::abs(magnitudes[j]);
   }
   
   // Take the logarithm of Mel energies
@@ -235,42 +431,45 @@ double WaveformAnalyzer::calculateCosineDistance(const double mfccSet1[numCoeffi
   return (1.0 - (dot / std::sqrt(mag1 * mag2))) / 2.0;
 }
 
-double WaveformAnalyzer::calculateMSE(double input[2][numSamples])
+double WaveformAnalyzer::calculateMSE(const double samples1[numSamples], const double samples2[numSamples])
 {
   double sum = 0.0;
   for (int i = 0; i < numSamples; ++i)
   {
-    double distance = std::abs(input[0][i] - input[1][i]);
+    double distance = std::abs(samples1[i] - samples2[i]);
     sum += distance * distance;
   }
   sum /= numSamples;
   return std::sqrt(sum);
 }
 
-void WaveformAnalyzer::calculateAmplitudeShiftRating(double samples[2][numSamples], double *avg, double *max)
+void WaveformAnalyzer::calculateAmplitudeEnvelope(const double waveform[numSamples], double average[numWindows], double max[numWindows], int count)
 {
-  double avgSum = 0.0;
-  double maxSum = 0.0;
-  int numWindows = (numSamples - window) / windowStep + 1;
-  for (int i = 0; i < numSamples; i += windowStep)
+  for (int i = 0, w = 0; i < numSamples && w < count; i += windowStep, ++w)
   {
-    double sum[2] = {0.0, 0.0};
-    double max[2] = {0.0, 0.0};
+    double sum = 0.0;
+    double peak = 0.0;
     if (i + window >= numSamples)
       break;
     for (int j = i; j < i + window && j < numSamples; ++j)
     {
-      if (samples[0][j] > max[0])
-        max[0] = std::abs(samples[0][j]);
-      if (samples[1][j] > max[1])
-        max[1] = std::abs(samples[1][j]);
-      sum[0] += samples[0][j];
-      sum[1] += samples[1][j];
+      if (waveform[j] > peak)
+        peak = std::abs(waveform[j]);
+      sum += waveform[j];
     }
-    sum[0] /= window;
-    sum[1] /= window;
-    avgSum += std::abs(sum[1] - sum[0]);
-    maxSum += std::abs(max[1] - max[0]);
+    average[w] = sum / window;
+    max[w] = peak;
+  }
+}
+
+void WaveformAnalyzer::calculateAmplitudeShiftRating(const Features &features1, const Features &features2, double *avg, double *max)
+{
+  double avgSum = 0.0;
+  double maxSum = 0.0;
+  for (int w = 0; w < numWindows; ++w)
+  {
+    avgSum += std::abs(features2.windowAverage[w] - features1.windowAverage[w]);
+    maxSum += std::abs(features2.windowMax[w] - features1.windowMax[w]);
   }
   avgSum /= numWindows;
   maxSum /= numWindows;
@@ -291,3 +490,105 @@ double WaveformAnalyzer::calculateLikenessRating(double mse, double fft, double
   sum /= mseWeight + fftWeight + mfccWeight + dtwWeight + cosWeight + avgAmpWeight + maxAmpWeight;
   return 100.0 * (1.0 - sum);
 }
+
+double WaveformAnalyzer::calculateLikenessRating(const Features &features1, const Features &features2, double *distance)
+{
+  double mse = calculateMSE(features1.waveform, features2.waveform);
+  double fft = calculateRMSE(features1.spectrum, features2.spectrum);
+  double mfcc = calculateEuclideanDistance(features1.mfccs, features2.mfccs);
+  double dtw = calculateDTW(features1.mfccs, features2.mfccs);
+  double cos = calculateCosineDistance(features1.mfccs, features2.mfccs);
+  double avgAmp;
+  double maxAmp;
+  calculateAmplitudeShiftRating(features1, features2, &avgAmp, &maxAmp);
+  if (distance != nullptr)
+  {
+    *distance = std::max((mse - mseMin) / (mseMax - mseMin), 0.0) * mseWeight;
+    *distance += std::max((fft - fftMin) / (fftMax - fftMin), 0.0) * fftWeight;
+    *distance += std::max((mfcc - mfccMin) / (mfccMax - mfccMin), 0.0) * mfccWeight;
+    *distance += std::max((dtw - dtwMin) / (dtwMax - dtwMin), 0.0) * dtwWeight;
+    *distance += std::max((cos - cosMin) / (cosMax - cosMin), 0.0) * cosWeight;
+    *distance += std::max((avgAmp - avgAmpMin) / (avgAmpMax - avgAmpMin), 0.0) * avgAmpWeight;
+    *distance += std::max((maxAmp - maxAmpMin) / (maxAmpMax - maxAmpMin), 0.0) * maxAmpWeight;
+    *distance /= mseWeight + fftWeight + mfccWeight + dtwWeight + cosWeight + avgAmpWeight + maxAmpWeight;
+  }
+  return calculateLikenessRating(mse, fft, mfcc, dtw, cos, avgAmp, maxAmp);
+}
+
+//The waveform gets normalized by its peak over the whole second, which isn't known yet, but it lies between the
+//peak of the samples so far and 1.0, so the normalized samples so far are the raw ones scaled by some s in
+//[1, 1 / peak]. The MSE and both amplitude ratings only grow as more samples are compared, so their smallest
+//possible values over that range of s are lower bounds of the final ones. Each one is minimized on its own,
+//which can only make the bound looser, and every other rating is taken as a perfect match.
+double WaveformAnalyzer::calculateLikenessBound(const uint8_t samples[sampleRate], int count, const Features &reference)
+{
+  std::pair<double, double> points[numWindows];
+  double waveform[numSamples];
+  double average[numWindows];
+  double max[numWindows];
+  double peak = 0.0;
+  double sumXX = 0.0;
+  double sumXR = 0.0;
+  double sumRR = 0.0;
+  double minScale = 1.0;
+  double maxScale;
+  double scale;
+  double mse;
+  double amp[2];
+  double sum;
+  int numComplete = 0;
+  for (int i = 0; i < count; ++i)
+  {
+    waveform[i] = samples[i] / 128.0 - 1.0;
+    peak = std::max(peak, std::abs(waveform[i]));
+    sumXX += waveform[i] * waveform[i];
+    sumXR += waveform[i] * reference.waveform[i];
+    sumRR += reference.waveform[i] * reference.waveform[i];
+  }
+  maxScale = (peak > 0.0) ? 1.0 / peak:1.0;
+  
+  // Sum of (s * x - r)^2 is a parabola in s
+  scale = (sumXX > 0.0) ? std::min(std::max(sumXR / sumXX, minScale), maxScale):minScale;
+  mse = std::sqrt(std::max(scale * scale * sumXX - 2.0 * scale * sumXR + sumRR, 0.0) / numSamples);
+  
+  // Sum of |s * a - b| over the complete windows is smallest at the weighted median of b / a
+  while (numComplete < numWindows && numComplete * windowStep + window <= count)
+    ++numComplete;
+  calculateAmplitudeEnvelope(waveform, average, max, numComplete);
+  for (int rating = 0; rating < 2; ++rating)
+  {
+    const double *values = (rating == 0) ? average:max;
+    const double *targets = (rating == 0) ? reference.windowAverage:reference.windowMax;
+    double totalWeight = 0.0;
+    double weight = 0.0;
+    int numPoints = 0;
+    for (int w = 0; w < numComplete; ++w)
+    {
+      if (values[w] == 0.0)
+        continue;
+      points[numPoints++] = std::make_pair(targets[w] / values[w], std::abs(values[w]));
+      totalWeight += std::abs(values[w]);
+    }
+    std::sort(points, points + numPoints);
+    scale = minScale;
+    for (int i = 0; i < numPoints; ++i)
+    {
+      weight += points[i].second;
+      if (2.0 * weight >= totalWeight)
+      {
+        scale = std::min(std::max(points[i].first, minScale), maxScale);
+        break;
+      }
+    }
+    sum = 0.0;
+    for (int w = 0; w < numComplete; ++w)
+      sum += std::abs(targets[w] - scale * values[w]);
+    amp[rating] = sum / numWindows;
+  }
+  
+  sum = applyThreshold(mse, mseMin, mseMax) * mseWeight;
+  sum += applyThreshold(amp[0], avgAmpMin, avgAmpMax) * avgAmpWeight;
+  sum += applyThreshold(amp[1], maxAmpMin, maxAmpMax) * maxAmpWeight;
+  sum /= mseWeight + fftWeight + mfccWeight + dtwWeight + cosWeight + avgAmpWeight + maxAmpWeight;
+  return 100.0 * (1.0 - sum);
+}
@@ -62,10 +62,27 @@ namespace WaveformAnalyzer
   constexpr double baseFrequency = 261.6;
   constexpr int window = (sampleRate / baseFrequency) * 1.5;
   constexpr int windowStep = (sampleRate / baseFrequency) / 2.0;
-  void fft(std::complex<double> data[numSamples]);
+  constexpr int numWindows = (numSamples - window) / windowStep + 1;
+  //Everything the likeness rating needs from one second of samples, none of it depends on the other waveform
+  struct Features
+  {
+    double waveform[numSamples];
+    double spectrum[numFrequencies];
+    double mfccs[numCoefficients];
+    double windowAverage[numWindows];
+    double windowMax[numWindows];
+  };
+  //Spectrum (bins 0 to numSamples / 2) of real input
+  void fft(const double input[numSamples], std::complex<double> output[numFrequencies]);
   void normalize(std::complex<double> *data, int size);
   void normalize(double *data, int size);
-  double calculateRMSE(double data[2][numFrequencies]);
+  //Normalized waveform (zero padded to numSamples) of one second of 8-bit samples
+  void loadSamples(const uint8_t samples[sampleRate], double waveform[numSamples]);
+  //Normalized waveform (zero padded to numSamples) and normalized FFT magnitudes of one second of 8-bit preview samples
+  void analyzeSamples(const uint8_t samples[sampleRate], double waveform[numSamples], double spectrum[numFrequencies]);
+  //All of the above plus the MFCCs and amplitude envelope
+  void analyzeFeatures(const uint8_t samples[sampleRate], Features *features);
+  double calculateRMSE(const double data1[numFrequencies], const double data2[numFrequencies]);
   void fillMelFilterbank(double melFilterbank[numMelFilters][numFrequencies]);
   void applyDCT(const double *input, double *output);
   void calculateMFCCs(const double fftMagnitudes[numFrequencies], double mfccs[numCoefficients]);
@@ -74,9 +91,18 @@ namespace WaveformAnalyzer
   double dotProduct(const double *a, const double *b);
   double magnitude(const double *v);
   double calculateCosineDistance(const double mfccSet1[numCoefficients], const double mfccSet2[numCoefficients]);
-  double calculateMSE(double samples[2][numSamples]);
-  void calculateAmplitudeShiftRating(double samples[2][numSamples], double *avg, double *max);
+  double calculateMSE(const double samples1[numSamples], const double samples2[numSamples]);
+  //Average and peak level of the first count windows of waveform
+  void calculateAmplitudeEnvelope(const double waveform[numSamples], double average[numWindows], double max[numWindows], int count=numWindows);
+  void calculateAmplitudeShiftRating(const Features &features1, const Features &features2, double *avg, double *max);
   double calculateLikenessRating(double mse, double fft, double mfcc, double dtw, double cos, double avgAmp, double maxAmp);
+  //Same as SpectrumPreview::getLikenessRating() of features1 (the patch) against features2 (the reference). distance
+  //is the weighted average of the ratings only clamped at their min, it keeps going down as two waveforms get
+  //closer even while some ratings are past their max and the likeness rating is flat.
+  double calculateLikenessRating(const Features &features1, const Features &features2, double *distance=nullptr);
+  //Upper bound of the likeness rating against reference of any second of samples that starts with the first count
+  //of samples, lets a search drop a candidate before it is fully rendered and analyzed
+  double calculateLikenessBound(const uint8_t samples[sampleRate], int count, const Features &reference);
   inline double euclideanDistance(double value1, double value2) {return (value2 - value1) * (value2 - value1);}
   inline double applyThreshold(double value, double min, double max) {return std::max(std::min((value - min) / (max - min), 1.0), 0.0);}
 };
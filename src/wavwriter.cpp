@@ -0,0 +1,185 @@
+/**********************************************************************************
+ * MIT License                                                                    *
+ *                                                                                *
+ * Copyright (c) 2023 Justin (tuxinator2009) Davis                                *
+ *                                                                                *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy   *
+ * of this software and associated documentation files (the "Software"), to deal  *
+ * in the Software without restriction, including without limitation the rights   *
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+ * copies of the Software, and to permit persons to whom the Software is          *
+ * furnished to do so, subject to the following conditions:                       *
+ *                                                                                *
+ * The above copyright notice and this permission notice shall be included in all *
+ * copies or substantial portions of the Software.                                *
+ *                                                                                *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+ * SOFTWARE.                                                                      *
+ **********************************************************************************/
+
+#include <cstring>
+#include "wavwriter.h"
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#endif
+
+WavWriter::WavWriter(unsigned samplerate, FMSource::SampleFormat format, Container container) : buffer(BUFFER_SIZE)
+{
+  this->samplerate = samplerate;
+  this->format = format;
+  this->container = container;
+  uncached = false;
+  used = 0;
+  dataSize = 0;
+  cached = 0;
+}
+
+WavWriter::~WavWriter()
+{
+  if (file.isOpen())
+    close();
+}
+
+bool WavWriter::open(const QString &location)
+{
+  if (file.isOpen())
+    close();
+  error.clear();
+  used = 0;
+  dataSize = 0;
+  cached = 0;
+  file.setFileName(location);
+  //QFile's own buffer would only add a copy, everything goes through the writer's buffer
+  if (!file.open(QFile::WriteOnly | QFile::Truncate | QFile::Unbuffered))
+  {
+    error = file.errorString();
+    return false;
+  }
+#ifdef POSIX_FADV_SEQUENTIAL
+  posix_fadvise(file.handle(), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+  if (container == Container::Wav)
+  {
+    //Sizes are filled in by close()
+    memset(buffer.data(), 0, headerSize());
+    used = headerSize();
+  }
+  return true;
+}
+
+bool WavWriter::write(const int32_t *bus, qint64 numSamples)
+{
+  int sampleSize = FMSource::bytesPerSample(format);
+  if (!file.isOpen())
+    return false;
+  while (numSamples > 0)
+  {
+    qint64 count = qMin(numSamples, (BUFFER_SIZE - used) / sampleSize);
+    if (count == 0)
+    {
+      if (!flush())
+        return false;
+      continue;
+    }
+    FMSource::convert(bus, buffer.data() + used, count, format);
+    used += count * sampleSize;
+    dataSize += count * sampleSize;
+    bus += count;
+    numSamples -= count;
+  }
+  return true;
+}
+
+bool WavWriter::close()
+{
+  //RIFF chunks are padded to an even length, only 8 bit samples can leave the data chunk odd
+  int padding = (container == Container::Wav) ? (dataSize & 1):0;
+  if (!file.isOpen())
+    return false;
+  if (!flush())
+    return false;
+  if (padding > 0 && file.write("\0", 1) != 1)
+  {
+    fail(file.errorString());
+    return false;
+  }
+  if (container == Container::Wav)
+  {
+    char header[FLOAT_HEADER_SIZE];
+    int size = headerSize();
+    int sampleSize = FMSource::bytesPerSample(format);
+    bool pcm = format != FMSource::SampleFormat::Float;
+    auto write16 = [](char *p, uint16_t v) {p[0] = v & 0xFF; p[1] = v >> 8;};
+    auto write32 = [](char *p, uint32_t v) {for (int i = 0; i < 4; ++i) p[i] = (v >> (i * 8)) & 0xFF;};
+    if (dataSize + padding > 0xFFFFFFFFll - (size - 8))
+    {
+      fail("The song is too long for a WAV file.");
+      return false;
+    }
+    memcpy(header, "RIFF", 4);
+    write32(header + 4, size - 8 + dataSize + padding);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    write32(header + 16, pcm ? 16:18);
+    write16(header + 20, pcm ? 1:3); //PCM or IEEE float
+    write16(header + 22, 1); //mono
+    write32(header + 24, samplerate);
+    write32(header + 28, samplerate * sampleSize);
+    write16(header + 32, sampleSize);
+    write16(header + 34, sampleSize * 8);
+    if (!pcm)
+    {
+      //Formats other than PCM need the extension size (none here) and a fact chunk with the number of frames
+      write16(header + 36, 0);
+      memcpy(header + 38, "fact", 4);
+      write32(header + 42, 4);
+      write32(header + 46, dataSize / sampleSize);
+    }
+    //The pad byte isn't part of the data chunk's size
+    memcpy(header + size - 8, "data", 4);
+    write32(header + size - 4, dataSize);
+    if (!file.seek(0) || file.write(header, size) != size)
+    {
+      fail(file.errorString());
+      return false;
+    }
+  }
+#ifdef POSIX_FADV_DONTNEED
+  if (uncached)
+    posix_fadvise(file.handle(), 0, 0, POSIX_FADV_DONTNEED);
+#endif
+  file.close();
+  return true;
+}
+
+bool WavWriter::flush()
+{
+  if (used > 0 && file.write(buffer.constData(), used) != used)
+  {
+    fail(file.errorString());
+    return false;
+  }
+#ifdef POSIX_FADV_DONTNEED
+  //Pages that haven't been written back yet are kept, they are dropped by a later call once they have
+  if (uncached && file.pos() - cached >= 16 * BUFFER_SIZE)
+  {
+    //A length of 0 would mean the whole file, including what was just written
+    if (cached > 0)
+      posix_fadvise(file.handle(), 0, cached, POSIX_FADV_DONTNEED);
+    cached = file.pos();
+  }
+#endif
+  used = 0;
+  return true;
+}
+
+//Removes what was written so a failed export doesn't leave a truncated file behind
+void WavWriter::fail(const QString &reason)
+{
+  error = reason;
+  file.remove();
+}
@@ -0,0 +1,72 @@
+/**********************************************************************************
+ * MIT License                                                                    *
+ *                                                                                *
+ * Copyright (c) 2023 Justin (tuxinator2009) Davis                                *
+ *                                                                                *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy   *
+ * of this software and associated documentation files (the "Software"), to deal  *
+ * in the Software without restriction, including without limitation the rights   *
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+ * copies of the Software, and to permit persons to whom the Software is          *
+ * furnished to do so, subject to the following conditions:                       *
+ *                                                                                *
+ * The above copyright notice and this permission notice shall be included in all *
+ * copies or substantial portions of the Software.                                *
+ *                                                                                *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+ * SOFTWARE.                                                                      *
+ **********************************************************************************/
+
+#ifndef WAVWRITER_H
+#define WAVWRITER_H
+
+#include <QFile>
+#include <QString>
+#include <QVector>
+#include "FMSource.h"
+
+//Streams rendered audio to a file as headerless samples or a mono RIFF/WAVE file (8 bit unsigned PCM,
+//16 bit PCM or 32 bit IEEE float). Samples are converted straight into one large buffer that is reused for
+//every file the writer opens, so exports go out in a few big writes instead of many small ones.
+//The WAV header is written with empty sizes when the file is opened and patched when it's closed.
+//An odd length data chunk gets the pad byte RIFF requires.
+class WavWriter
+{
+  public:
+    enum class Container {Raw, Wav};
+    WavWriter(unsigned samplerate=8000, FMSource::SampleFormat format=FMSource::SampleFormat::UInt8, Container container=Container::Wav);
+    ~WavWriter();
+    //Asks the OS to drop written data from the page cache as the file is streamed out (where posix_fadvise
+    //is available) so exporting long songs doesn't push everything else out of memory
+    void setUncached(bool enabled) {uncached = enabled;}
+    static QString extension(Container container) {return (container == Container::Wav) ? ".wav":".raw";}
+    bool open(const QString &location);
+    bool write(const int32_t *bus, qint64 numSamples);
+    bool close();
+    //Gives up on the file with reason as the error, what was written so far is removed
+    void fail(const QString &reason);
+    QString errorString() const {return error;}
+  private:
+    static constexpr int BUFFER_SIZE = 256 * 1024;
+    static constexpr int HEADER_SIZE = 44;
+    static constexpr int FLOAT_HEADER_SIZE = 58;
+    int headerSize() const {return (format == FMSource::SampleFormat::Float) ? FLOAT_HEADER_SIZE:HEADER_SIZE;}
+    bool flush();
+    QFile file;
+    QVector<char> buffer;
+    QString error;
+    qint64 used;
+    qint64 dataSize;
+    qint64 cached;
+    unsigned samplerate;
+    FMSource::SampleFormat format;
+    Container container;
+    bool uncached;
+};
+
+#endif //WAVWRITER_H
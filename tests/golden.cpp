@@ -0,0 +1,825 @@
+/**********************************************************************************
+ * MIT License                                                                    *
+ *                                                                                *
+ * Copyright (c) 2023 Justin (tuxinator2009) Davis                                *
+ *                                                                                *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy   *
+ * of this software and associated documentation files (the "Software"), to deal  *
+ * in the Software without restriction, including without limitation the rights   *
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+ * copies of the Software, and to permit persons to whom the Software is          *
+ * furnished to do so, subject to the following conditions:                       *
+ *                                                                                *
+ * The above copyright notice and this permission notice shall be included in all *
+ * copies or substantial portions of the Software.                                *
+ *                                                                                *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+ * SOFTWARE.                                                                      *
+ **********************************************************************************/
+
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+#include <QString>
+#include <QTemporaryDir>
+#include <QVector>
+#include "FMSynth/CompiledPatch.h"
+#include "FMSynth/Decimator.h"
+#include "FMSynth/Patch.h"
+#include "FMSynth/Voice.h"
+#include "FMSynth/VoiceBank.h"
+#include "FMSource.h"
+#include "featurecache.h"
+#include "fmproject.h"
+#include "fmsong.h"
+#include "globals.h"
+#include "songrenderer.h"
+#include "waveformanalyzer.h"
+
+#include "bass.h"
+#include "celesta.h"
+#include "cowbell.h"
+#include "didgeridoo.h"
+#include "distguitar.h"
+#include "echo.h"
+#include "epiano.h"
+#include "gong.h"
+#include "guitar.h"
+#include "noise.h"
+#include "organ.h"
+#include "piano.h"
+#include "saw.h"
+#include "sine.h"
+#include "square.h"
+#include "sweep.h"
+#include "theremin.h"
+#include "trumpet.h"
+#include "trumpet2.h"
+#include "violin.h"
+
+//Golden-output regression test. Renders every stock instrument over a matrix of keys and velocities
+//through FMSynth::Voice<8000> and every song of the example projects through FMSource, and compares a
+//hash of each output with the digests checked in to golden.txt. Any change to the synth or the
+//sequencer that is meant to be bit-exact has to pass this unchanged. The instruments are also compiled
+//to FMSynth::CompiledPatch at compile time, notes started from those have to match the plain patches,
+//and played on the lanes of a FMSynth::VoiceBank, which has to match the same notes on lone voices.
+//Square, saw and triangle operators are rendered on every operator slot, the square and saw also through
+//the band-limited oscillator at 44.1 kHz, and the stock instruments with the sine table. The Decimator
+//has to keep its passband and stopband. FMSource also has to take the voice each allocation and steal
+//policy picks when a channel runs out of voices. The feature cache has to read back what it wrote and
+//recompute stale or broken files, and the likeness bound PatchFitter aborts on has to stay an upper bound.
+//The patch digests were generated from the synth as it was before any of the optimizations landed.
+//The song digests come from the 32-bit voice mix of FMSource, the 8-bit pairwise mix it replaced rounded
+//differently. The song-silentfirst digests play the same songs with the SilentFirst voice
+//allocation, which lets release tails ring out instead of cutting them off with the next note.
+//Usage: fmstudio-golden [--update], --update rewrites golden.txt with the current output.
+
+struct Instrument
+{
+  const char *name;
+  const FMSynth::Patch *patch;
+  const FMSynth::CompiledPatch<8000> *compiled;
+};
+
+struct Waveform
+{
+  const char *name;
+  uint8_t waveform;
+  bool bandlimited;
+};
+
+struct Digest
+{
+  QString name;
+  uint64_t hash;
+};
+
+//Notes started one after the other on a channel of 3 voices (a duration d lasts (d + 1) * 125 samples at
+//the test tempo), then a new note C5 whose voice has to come from the expected slot
+struct StealCase
+{
+  const char *name;
+  FMSource::VoiceAllocation allocation;
+  FMSource::StealPolicy policy;
+  int numNotes;
+  uint8_t keys[3];
+  uint8_t velocities[3];
+  int durations[3];
+  uint8_t expected[3];
+};
+
+static constexpr FMSynth::CompiledPatch<8000> compiled_bass = FMSynth::CompiledPatch<8000>::compile(patch_bass);
+static constexpr FMSynth::CompiledPatch<8000> compiled_celesta = FMSynth::CompiledPatch<8000>::compile(patch_celesta);
+static constexpr FMSynth::CompiledPatch<8000> compiled_cowbell = FMSynth::CompiledPatch<8000>::compile(patch_cowbell);
+static constexpr FMSynth::CompiledPatch<8000> compiled_didgeridoo = FMSynth::CompiledPatch<8000>::compile(patch_digeridoo_e2);
+static constexpr FMSynth::CompiledPatch<8000> compiled_distguitar = FMSynth::CompiledPatch<8000>::compile(patch_dist_guitar);
+static constexpr FMSynth::CompiledPatch<8000> compiled_echo = FMSynth::CompiledPatch<8000>::compile(patch_echo);
+static constexpr FMSynth::CompiledPatch<8000> compiled_epiano = FMSynth::CompiledPatch<8000>::compile(patch_e_piano);
+static constexpr FMSynth::CompiledPatch<8000> compiled_gong = FMSynth::CompiledPatch<8000>::compile(patch_gong);
+static constexpr FMSynth::CompiledPatch<8000> compiled_guitar = FMSynth::CompiledPatch<8000>::compile(patch_guitar);
+static constexpr FMSynth::CompiledPatch<8000> compiled_noise = FMSynth::CompiledPatch<8000>::compile(patch_noise);
+static constexpr FMSynth::CompiledPatch<8000> compiled_organ = FMSynth::CompiledPatch<8000>::compile(patch_organ);
+static constexpr FMSynth::CompiledPatch<8000> compiled_piano = FMSynth::CompiledPatch<8000>::compile(patch_piano);
+static constexpr FMSynth::CompiledPatch<8000> compiled_saw = FMSynth::CompiledPatch<8000>::compile(patch_saw);
+static constexpr FMSynth::CompiledPatch<8000> compiled_sine = FMSynth::CompiledPatch<8000>::compile(patch_sine);
+static constexpr FMSynth::CompiledPatch<8000> compiled_square = FMSynth::CompiledPatch<8000>::compile(patch_square);
+static constexpr FMSynth::CompiledPatch<8000> compiled_sweep = FMSynth::CompiledPatch<8000>::compile(patch_sweep);
+static constexpr FMSynth::CompiledPatch<8000> compiled_theremin = FMSynth::CompiledPatch<8000>::compile(patch_theremin);
+static constexpr FMSynth::CompiledPatch<8000> compiled_trumpet = FMSynth::CompiledPatch<8000>::compile(patch_trumpet);
+static constexpr FMSynth::CompiledPatch<8000> compiled_trumpet2 = FMSynth::CompiledPatch<8000>::compile(patch_Trumpet2);
+static constexpr FMSynth::CompiledPatch<8000> compiled_violin = FMSynth::CompiledPatch<8000>::compile(patch_violin);
+
+static const Instrument instruments[] =
+{
+  {"bass", &patch_bass, &compiled_bass},
+  {"celesta", &patch_celesta, &compiled_celesta},
+  {"cowbell", &patch_cowbell, &compiled_cowbell},
+  {"didgeridoo", &patch_digeridoo_e2, &compiled_didgeridoo},
+  {"distguitar", &patch_dist_guitar, &compiled_distguitar},
+  {"echo", &patch_echo, &compiled_echo},
+  {"epiano", &patch_e_piano, &compiled_epiano},
+  {"gong", &patch_gong, &compiled_gong},
+  {"guitar", &patch_guitar, &compiled_guitar},
+  {"noise", &patch_noise, &compiled_noise},
+  {"organ", &patch_organ, &compiled_organ},
+  {"piano", &patch_piano, &compiled_piano},
+  {"saw", &patch_saw, &compiled_saw},
+  {"sine", &patch_sine, &compiled_sine},
+  {"square", &patch_square, &compiled_square},
+  {"sweep", &patch_sweep, &compiled_sweep},
+  {"theremin", &patch_theremin, &compiled_theremin},
+  {"trumpet", &patch_trumpet, &compiled_trumpet},
+  {"trumpet2", &patch_Trumpet2, &compiled_trumpet2},
+  {"violin", &patch_violin, &compiled_violin}
+};
+static const int keys[] = {24, 36, 48, 60, 72, 84, 96};
+static const int velocities[] = {32, 80, 127};
+//Played on each operator of patch_organ in turn, only square and saw have a band-limited oscillator
+static const Waveform waveforms[] =
+{
+  {"square", FMSynth::Patch::Operator::Square, true},
+  {"saw", FMSynth::Patch::Operator::Saw, true},
+  {"triangle", FMSynth::Patch::Operator::Triangle, false}
+};
+static const int waveKeys[] = {36, 60, 84};
+static const char *projects[] = {"mario.fmx", "experiments.fmx"};
+//C4 is the oldest and ends last, D4 is quiet and E4 is the newest and ends first. A note of duration 0
+//is released before the next one starts and is left sounding its release. An expected key of 0 is a
+//voice slot that is never used.
+static const StealCase stealCases[] =
+{
+  {"oldest", FMSource::VoiceAllocation::FirstFree, FMSource::StealPolicy::Oldest, 3, {60, 62, 64}, {127, 20, 127}, {63, 47, 31}, {72, 62, 64}},
+  {"quietest", FMSource::VoiceAllocation::FirstFree, FMSource::StealPolicy::Quietest, 3, {60, 62, 64}, {127, 20, 127}, {63, 47, 31}, {60, 72, 64}},
+  {"releasedfirst", FMSource::VoiceAllocation::FirstFree, FMSource::StealPolicy::ReleasedFirst, 3, {60, 62, 64}, {127, 20, 127}, {63, 47, 31}, {60, 62, 72}},
+  {"firstfree released", FMSource::VoiceAllocation::FirstFree, FMSource::StealPolicy::Oldest, 2, {60, 62}, {127, 127}, {63, 0}, {60, 72, 0}},
+  {"silentfirst oldest", FMSource::VoiceAllocation::SilentFirst, FMSource::StealPolicy::Oldest, 3, {60, 62, 64}, {127, 20, 127}, {63, 47, 31}, {72, 62, 64}},
+  {"silentfirst released before held", FMSource::VoiceAllocation::SilentFirst, FMSource::StealPolicy::Oldest, 3, {60, 62, 64}, {127, 127, 127}, {63, 0, 63}, {60, 72, 64}},
+  {"silentfirst silent before released", FMSource::VoiceAllocation::SilentFirst, FMSource::StealPolicy::Oldest, 2, {60, 62}, {127, 127}, {63, 0}, {60, 62, 72}}
+};
+static constexpr int STEAL_NOTE_SAMPLES = 200;
+static constexpr int HOLD_SAMPLES = 4000;
+static constexpr int MAX_RELEASE_SAMPLES = 16000;
+//The band-limited oscillator is rendered at 44.1 kHz in blocks of 50 ms
+static constexpr int BLEP_BLOCK_SAMPLES = 2205;
+static constexpr int BLEP_HOLD_BLOCKS = 5;
+static constexpr int BLEP_MAX_RELEASE_BLOCKS = 20;
+//Partial renders are bounded every LIKENESS_STEP samples, PatchFitter checks every 2000
+static constexpr int LIKENESS_STEP = 500;
+static constexpr double DECIMATOR_PASSBAND_DB = 0.1;
+static constexpr double DECIMATOR_STOPBAND_DB = -74.0;
+//Songs that never reach their end are cut off after 10 minutes
+static constexpr int MAX_SONG_SAMPLES = 8000 * 600;
+
+//64-bit FNV-1a
+static uint64_t hashBytes(const uint8_t *data, int size, uint64_t hash=0xcbf29ce484222325ull)
+{
+  for (int i = 0; i < size; ++i)
+  {
+    hash ^= data[i];
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+//Holds the note for HOLD_SAMPLES, then renders the release until the voice goes idle. The block
+//renderer, started from the compiled patch, has to produce the same samples as update().
+static QByteArray renderNote(const FMSynth::Patch &patch, const FMSynth::CompiledPatch<8000> &compiled, int key, int velocity, bool sineTable, bool *blockMatches)
+{
+  FMSynth::Voice<8000> voice;
+  FMSynth::Voice<8000> blockVoice;
+  QByteArray data;
+  int16_t block[HOLD_SAMPLES];
+  voice.setSineTable(sineTable);
+  blockVoice.setSineTable(sineTable);
+  voice.noteOn(patch, key, velocity);
+  blockVoice.noteOn(compiled, key, velocity);
+  for (int i = 0; i < HOLD_SAMPLES + MAX_RELEASE_SAMPLES; ++i)
+  {
+    if (i == HOLD_SAMPLES)
+      voice.noteOff();
+    else if (i > HOLD_SAMPLES && voice.finished())
+      break;
+    data += (char)voice.update();
+  }
+  *blockMatches = true;
+  for (int offset = 0; offset < data.size(); offset += HOLD_SAMPLES)
+  {
+    int length = (data.size() - offset < HOLD_SAMPLES) ? data.size() - offset:HOLD_SAMPLES;
+    if (offset == HOLD_SAMPLES)
+      blockVoice.noteOff();
+    blockVoice.render(block, length);
+    for (int i = 0; i < length; ++i)
+    {
+      if ((uint8_t)(128 + block[i] / (1 << 8)) != (uint8_t)data[offset + i])
+        *blockMatches = false;
+    }
+  }
+  return data;
+}
+
+//Renders the note at 44.1 kHz as little-endian 16-bit samples, held for BLEP_HOLD_BLOCKS and then released
+//until the voice goes idle
+static QByteArray renderBandlimited(const FMSynth::Patch &patch, int key, bool bandlimited)
+{
+  FMSynth::Voice<44100> voice;
+  QByteArray data;
+  int16_t block[BLEP_BLOCK_SAMPLES];
+  voice.setBandlimited(bandlimited);
+  voice.noteOn(patch, key, 127);
+  for (int i = 0; i < BLEP_HOLD_BLOCKS + BLEP_MAX_RELEASE_BLOCKS; ++i)
+  {
+    if (i == BLEP_HOLD_BLOCKS)
+      voice.noteOff();
+    int length = voice.render(block, BLEP_BLOCK_SAMPLES);
+    for (int j = 0; j < length; ++j)
+    {
+      data += (char)(block[j] & 0xFF);
+      data += (char)((block[j] >> 8) & 0xFF);
+    }
+    if (length < BLEP_BLOCK_SAMPLES)
+      break;
+  }
+  return data;
+}
+
+//Gain in dB of a sine at frequency (a fraction of the output rate) through a Decimator. The output is
+//correlated with the sine where it stays below the output Nyquist frequency, anything above can only come
+//back as aliasing, which is measured by its level.
+static double decimatorGain(unsigned factor, double frequency)
+{
+  constexpr int OUTPUT_SAMPLES = 8192;
+  constexpr int SKIPPED_SAMPLES = 256;
+  constexpr double AMPLITUDE = 16000.0;
+  FMSynth::Decimator decimator(factor);
+  QVector<int32_t> input(OUTPUT_SAMPLES * factor);
+  QVector<int32_t> output(OUTPUT_SAMPLES + FMSynth::Decimator::MAX_FINISH);
+  double sine = 0.0, cosine = 0.0, power = 0.0, amplitude;
+  int count = 0;
+  for (int i = 0; i < input.size(); ++i)
+    input[i] = (int32_t)lround(AMPLITUDE * sin(2.0 * M_PI * frequency * i / factor));
+  size_t length = decimator.process(input.data(), input.size(), output.data());
+  decimator.finish(output.data() + length);
+  //Leave out the edges, where the stream starts and ends with silence
+  for (int i = SKIPPED_SAMPLES; i < OUTPUT_SAMPLES - SKIPPED_SAMPLES; ++i, ++count)
+  {
+    sine += output[i] * sin(2.0 * M_PI * frequency * i);
+    cosine += output[i] * cos(2.0 * M_PI * frequency * i);
+    power += (double)output[i] * output[i];
+  }
+  if (frequency < 0.5)
+    amplitude = 2.0 * sqrt(sine * sine + cosine * cosine) / count;
+  else
+    amplitude = sqrt(2.0 * power / count);
+  return 20.0 * log10(amplitude / AMPLITUDE + 1e-12);
+}
+
+//Sweeps sines through the Decimator at 2x and 4x, returns the number of frequencies outside its response.
+//Up to 0.4 of the output rate the gain has to stay within DECIMATOR_PASSBAND_DB. From 0.6 up to the input
+//Nyquist frequency everything that aliases into that passband has to be down by DECIMATOR_STOPBAND_DB, the
+//rest only falls between the passband and the output Nyquist frequency.
+static int checkDecimator()
+{
+  int failures = 0;
+  for (unsigned factor : {2u, 4u})
+  {
+    for (int step = 1; step <= 40; ++step)
+    {
+      double frequency = step * 0.01;
+      double gain = decimatorGain(factor, frequency);
+      if (fabs(gain) > DECIMATOR_PASSBAND_DB)
+      {
+        fprintf(stderr, "FAIL decimator/%ux: %.3f of the output rate passes at %.3f dB\n", factor, frequency, gain);
+        ++failures;
+      }
+    }
+    for (int step = 120; step <= (int)factor * 100; ++step)
+    {
+      double frequency = step * 0.005;
+      double gain;
+      if (fabs(frequency - round(frequency)) > 0.4)
+        continue;
+      gain = decimatorGain(factor, frequency);
+      if (gain > DECIMATOR_STOPBAND_DB)
+      {
+        fprintf(stderr, "FAIL decimator/%ux: %.3f of the output rate aliases at %.1f dB\n", factor, frequency, gain);
+        ++failures;
+      }
+    }
+  }
+  return failures;
+}
+
+//One second of the note as PatchFitter and the preview render it, released after half a second
+static void renderSecond(const FMSynth::Patch &patch, int key, uint8_t samples[WaveformAnalyzer::sampleRate])
+{
+  FMSynth::Voice<8000> voice;
+  voice.noteOn(patch, key, 127);
+  for (int i = 0; i < WaveformAnalyzer::sampleRate; ++i)
+  {
+    samples[i] = voice.update();
+    if (i == WaveformAnalyzer::sampleRate / 2)
+      voice.noteOff();
+  }
+}
+
+//Compares what a feature cache file holds, the waveform isn't part of it
+static bool sameCachedFeatures(const WaveformAnalyzer::Features &features1, const WaveformAnalyzer::Features &features2)
+{
+  return memcmp(features1.spectrum, features2.spectrum, sizeof(features1.spectrum)) == 0 && memcmp(features1.mfccs, features2.mfccs, sizeof(features1.mfccs)) == 0
+      && memcmp(features1.windowAverage, features2.windowAverage, sizeof(features1.windowAverage)) == 0 && memcmp(features1.windowMax, features2.windowMax, sizeof(features1.windowMax)) == 0;
+}
+
+//Analyzes a note through FeatureCache with home as the home directory. The features have to match a fresh
+//analysis and read back from the file it wrote. That file is then put in place for other notes as it is
+//(its features have to be used), with another version and cut short (both have to be computed again and
+//the file rewritten). Returns the number of failures.
+static int checkFeatureCache(const QString &home)
+{
+  const char *names[] = {"valid", "version", "truncated"};
+  uint8_t samples[4][WaveformAnalyzer::sampleRate];
+  WaveformAnalyzer::Features *written = new WaveformAnalyzer::Features;
+  WaveformAnalyzer::Features *fresh = new WaveformAnalyzer::Features;
+  WaveformAnalyzer::Features *cached = new WaveformAnalyzer::Features;
+  QByteArray files[3];
+  QFile file;
+  int failures = 0;
+  Globals::homePath = home;
+  for (int i = 0; i < 4; ++i)
+    renderSecond(*instruments[i].patch, 60, samples[i]);
+  WaveformAnalyzer::analyzeFeatures(samples[0], written);
+  FeatureCache::analyze(samples[0], cached);
+  if (!sameCachedFeatures(*written, *cached) || !FeatureCache::readFile(FeatureCache::filePath(samples[0]), cached) || !sameCachedFeatures(*written, *cached))
+  {
+    fprintf(stderr, "FAIL featurecache/read back: the cache file doesn't hold the features of a fresh analysis\n");
+    ++failures;
+  }
+  file.setFileName(FeatureCache::filePath(samples[0]));
+  if (file.open(QFile::ReadOnly))
+    files[0] = file.readAll();
+  file.close();
+  //The version follows the 32-bit magic, big-endian
+  files[1] = files[0];
+  files[1][7] = (char)(files[1][7] + 1);
+  files[2] = files[0].left(files[0].size() - 8);
+  for (int i = 0; i < 3; ++i)
+  {
+    bool passed;
+    file.setFileName(FeatureCache::filePath(samples[i + 1]));
+    if (!file.open(QFile::WriteOnly) || file.write(files[i]) != files[i].size())
+      passed = false;
+    else
+    {
+      file.close();
+      WaveformAnalyzer::analyzeFeatures(samples[i + 1], fresh);
+      FeatureCache::analyze(samples[i + 1], cached);
+      if (i == 0)
+        passed = sameCachedFeatures(*written, *cached);
+      else
+        passed = sameCachedFeatures(*fresh, *cached) && FeatureCache::readFile(file.fileName(), cached) && sameCachedFeatures(*fresh, *cached);
+    }
+    file.close();
+    if (!passed)
+    {
+      fprintf(stderr, "FAIL featurecache/%s: the file %s\n", names[i], (i == 0) ? "wasn't used":"wasn't recomputed");
+      ++failures;
+    }
+  }
+  delete written;
+  delete fresh;
+  delete cached;
+  return failures;
+}
+
+//PatchFitter drops a candidate as soon as the likeness bound of its partial render falls below the best
+//rating so far, so the bound may never be below the rating of the whole second. Every instrument is
+//rated against every instrument an octave down and up, bounded every LIKENESS_STEP samples. Returns the
+//number of bounds below their rating.
+static int checkLikenessBound()
+{
+  constexpr int numInstruments = sizeof(instruments) / sizeof(instruments[0]);
+  QVector<WaveformAnalyzer::Features> candidates(numInstruments);
+  QVector<WaveformAnalyzer::Features> references(2 * numInstruments);
+  QVector<uint8_t> samples(numInstruments * WaveformAnalyzer::sampleRate);
+  int failures = 0;
+  for (int i = 0; i < numInstruments; ++i)
+  {
+    uint8_t *candidate = samples.data() + i * WaveformAnalyzer::sampleRate;
+    uint8_t reference[WaveformAnalyzer::sampleRate];
+    renderSecond(*instruments[i].patch, 60, candidate);
+    WaveformAnalyzer::analyzeFeatures(candidate, &candidates[i]);
+    renderSecond(*instruments[i].patch, 48, reference);
+    WaveformAnalyzer::analyzeFeatures(reference, &references[2 * i]);
+    renderSecond(*instruments[i].patch, 72, reference);
+    WaveformAnalyzer::analyzeFeatures(reference, &references[2 * i + 1]);
+  }
+  for (int i = 0; i < numInstruments; ++i)
+  {
+    for (int j = 0; j < references.size(); ++j)
+    {
+      double distance;
+      double rating = WaveformAnalyzer::calculateLikenessRating(candidates[i], references[j], &distance);
+      //PatchFitter never keeps a rating that isn't finite (silence)
+      if (!std::isfinite(rating))
+        continue;
+      for (int count = LIKENESS_STEP; count < WaveformAnalyzer::sampleRate; count += LIKENESS_STEP)
+      {
+        double bound = WaveformAnalyzer::calculateLikenessBound(samples.data() + i * WaveformAnalyzer::sampleRate, count, references[j]);
+        if (bound < rating)
+        {
+          fprintf(stderr, "FAIL likeness/%s/%s/%d/%d: bound %f is below the rating %f\n", instruments[i].name, instruments[j / 2].name, (j % 2 == 0) ? 48:72, count, bound, rating);
+          ++failures;
+        }
+      }
+    }
+  }
+  return failures;
+}
+
+//Starts a note on one lane of a VoiceBank and on a lone voice per lane every BANK_STEP samples, releasing
+//an older one, with a pause now and then so the number of lanes playing goes up and down. Rendered in
+//uneven blocks, the bank added onto a 32-bit bus has to match the sum of the voices. Returns the number of
+//samples that differ.
+static int checkVoiceBank()
+{
+  constexpr int LANES = 8;
+  constexpr int BANK_STEP = 1500;
+  FMSynth::VoiceBank<8000, LANES> bank;
+  FMSynth::Voice<8000> voices[LANES];
+  int32_t bus[BANK_STEP];
+  int32_t sum[BANK_STEP];
+  int16_t block[BANK_STEP];
+  int numInstruments = sizeof(instruments) / sizeof(instruments[0]);
+  int mismatches = 0;
+  for (int step = 0; step < 3 * numInstruments; ++step)
+  {
+    const Instrument &instrument = instruments[step % numInstruments];
+    int lane = (step * 3) % LANES;
+    int key = keys[step % 7];
+    int velocity = velocities[step % 3];
+    if (step % 10 < 7)
+    {
+      if (step % 2 == 0)
+      {
+        bank.noteOn(lane, *instrument.patch, key, velocity);
+        voices[lane].noteOn(*instrument.patch, key, velocity);
+      }
+      else
+      {
+        bank.noteOn(lane, *instrument.compiled, key, velocity);
+        voices[lane].noteOn(*instrument.compiled, key, velocity);
+      }
+    }
+    bank.noteOff((lane + 2) % LANES);
+    voices[(lane + 2) % LANES].noteOff();
+    for (int offset = 0, length; offset < BANK_STEP; offset += length)
+    {
+      length = qMin(BANK_STEP - offset, 1 + (step * 389 + offset) % 700);
+      memset(bus, 0, length * sizeof(int32_t));
+      memset(sum, 0, length * sizeof(int32_t));
+      bank.renderAdd(bus, length);
+      for (auto &voice : voices)
+      {
+        voice.render(block, length);
+        for (int i = 0; i < length; ++i)
+          sum[i] += block[i];
+      }
+      for (int i = 0; i < length; ++i)
+      {
+        if (bus[i] != sum[i])
+          ++mismatches;
+      }
+    }
+  }
+  return mismatches;
+}
+
+//Plays each StealCase, returns the number of cases where C5 didn't end up in the expected voice
+static int checkStealPolicies()
+{
+  int failures = 0;
+  for (auto &test : stealCases)
+  {
+    FMSource source(1, 8000, FMSource::SampleFormat::UInt8, 3);
+    char data[STEAL_NOTE_SAMPLES];
+    QVector<uint8_t> expected;
+    source.setTempo(120);
+    source.setVoiceAllocation(test.allocation);
+    source.setStealPolicy(test.policy);
+    for (int i = 0; i < test.numNotes; ++i)
+    {
+      source.noteOn(0, patch_organ, test.keys[i], test.durations[i], test.velocities[i]);
+      source.read(data, sizeof(data));
+    }
+    source.noteOn(0, patch_organ, 72, 31);
+    QVector<uint8_t> keys = source.playingKeys(0);
+    for (auto key : test.expected)
+    {
+      if (key != 0)
+        expected += key;
+    }
+    if (keys != expected)
+    {
+      fprintf(stderr, "FAIL steal/%s: voices play", test.name);
+      for (auto key : keys)
+        fprintf(stderr, " %d", key);
+      fprintf(stderr, ", expected");
+      for (auto key : expected)
+        fprintf(stderr, " %d", key);
+      fprintf(stderr, "\n");
+      ++failures;
+    }
+  }
+  return failures;
+}
+
+static QByteArray renderSong(FMSong *song, FMSource::VoiceAllocation allocation, bool *finished)
+{
+  FMSource source(5);
+  QByteArray data;
+  source.setVoiceAllocation(allocation);
+  source.setTempo(song->getTempo());
+  source.playSong(song);
+  while (!source.atEnd() && data.size() < MAX_SONG_SAMPLES)
+    data += source.read(512);
+  *finished = source.atEnd();
+  return data;
+}
+
+//Checks the header of an 8 bit WAV file at 8 kHz, that its samples match data and that an odd data chunk
+//is padded to an even length, which the RIFF size includes
+static bool checkWav(const QByteArray &wav, const QByteArray &data)
+{
+  int padding = data.size() & 1;
+  auto read32 = [&wav](int i) {return (uint32_t)(uint8_t)wav[i] | ((uint32_t)(uint8_t)wav[i + 1] << 8) | ((uint32_t)(uint8_t)wav[i + 2] << 16) | ((uint32_t)(uint8_t)wav[i + 3] << 24);};
+  if (wav.size() != 44 + data.size() + padding || !wav.startsWith("RIFF") || wav.mid(8, 8) != "WAVEfmt " || wav.mid(36, 4) != "data")
+    return false;
+  if (padding > 0 && wav[wav.size() - 1] != 0)
+    return false;
+  return read32(4) == (uint32_t)wav.size() - 8 && read32(24) == 8000 && read32(40) == (uint32_t)data.size() && wav.mid(44, data.size()) == data;
+}
+
+//Streams the song to a WAV file and checks it against data
+static bool checkWavExport(FMSong *song, const QByteArray &data, const QString &location)
+{
+  QStringList errors = SongRenderer(1).exportSongs(QList<FMSong*>() << song, QStringList() << location, WavWriter::Container::Wav);
+  QFile file(location);
+  QByteArray wav;
+  if (!errors[0].isEmpty() || !file.open(QFile::ReadOnly))
+    return false;
+  wav = file.readAll();
+  file.close();
+  file.remove();
+  return checkWav(wav, data);
+}
+
+//Writes an odd number of 8 bit samples, the data chunk has to be followed by a pad byte
+static bool checkWavPadding(const QString &location)
+{
+  const int32_t bus[] = {0, 1 << 20, -(1 << 20)};
+  WavWriter writer;
+  QFile file(location);
+  QByteArray wav;
+  QByteArray data;
+  data.resize(3);
+  FMSource::convert(bus, data.data(), 3, FMSource::SampleFormat::UInt8);
+  if (!writer.open(location) || !writer.write(bus, 3) || !writer.close() || !file.open(QFile::ReadOnly))
+    return false;
+  wav = file.readAll();
+  file.close();
+  file.remove();
+  return checkWav(wav, data);
+}
+
+static bool loadGolden(const QString &location, QList<Digest> &digests)
+{
+  FILE *file = fopen(location.toLocal8Bit().data(), "r");
+  char line[256];
+  if (file == nullptr)
+    return false;
+  while (fgets(line, sizeof(line), file) != nullptr)
+  {
+    Digest digest;
+    char *name = strchr(line, ' ');
+    if (name == nullptr || line[0] == '#')
+      continue;
+    *name++ = '\0';
+    name[strcspn(name, "\r\n")] = '\0';
+    digest.hash = strtoull(line, nullptr, 16);
+    digest.name = name;
+    digests += digest;
+  }
+  fclose(file);
+  return true;
+}
+
+static bool saveGolden(const QString &location, const QList<Digest> &digests)
+{
+  FILE *file = fopen(location.toLocal8Bit().data(), "w");
+  if (file == nullptr)
+    return false;
+  fprintf(file, "# Generated by fmstudio-golden --update, FNV-1a 64 of the unsigned 8-bit 8 kHz output\n");
+  fprintf(file, "# patch/ digests match the original synth, song/ digests the 32-bit voice mix of FMSource\n");
+  fprintf(file, "# song-silentfirst/ digests play the songs with the SilentFirst voice allocation\n");
+  fprintf(file, "# blep/ digests are of the signed 16-bit little-endian 44.1 kHz output of the band-limited oscillator\n");
+  for (auto &digest : digests)
+    fprintf(file, "%016llx %s\n", (unsigned long long)digest.hash, digest.name.toLocal8Bit().data());
+  fclose(file);
+  return true;
+}
+
+int main(int argc, char *argv[])
+{
+  QString sourceDir(FMSTUDIO_SOURCE_DIR);
+  QString goldenLocation = sourceDir + "/tests/golden.txt";
+  QList<Digest> digests;
+  QList<Digest> golden;
+  QTemporaryDir exportDir;
+  bool update = argc > 1 && strcmp(argv[1], "--update") == 0;
+  int failures = 0;
+  for (auto &instrument : instruments)
+  {
+    for (int key : keys)
+    {
+      for (int velocity : velocities)
+      {
+        bool blockMatches;
+        QByteArray data = renderNote(*instrument.patch, *instrument.compiled, key, velocity, false, &blockMatches);
+        Digest digest;
+        digest.name = QString("patch/%1/%2/%3").arg(instrument.name).arg(key).arg(velocity);
+        digest.hash = hashBytes((const uint8_t*)data.constData(), data.size());
+        digests += digest;
+        if (!blockMatches)
+        {
+          fprintf(stderr, "FAIL %s: Voice::render from the CompiledPatch differs from Voice::update\n", digest.name.toLocal8Bit().data());
+          ++failures;
+        }
+      }
+    }
+  }
+  for (auto &instrument : instruments)
+  {
+    bool blockMatches;
+    QByteArray data = renderNote(*instrument.patch, *instrument.compiled, 60, 127, true, &blockMatches);
+    Digest digest;
+    digest.name = QString("sinetable/%1/60/127").arg(instrument.name);
+    digest.hash = hashBytes((const uint8_t*)data.constData(), data.size());
+    digests += digest;
+    if (!blockMatches)
+    {
+      fprintf(stderr, "FAIL %s: Voice::render from the CompiledPatch differs from Voice::update\n", digest.name.toLocal8Bit().data());
+      ++failures;
+    }
+  }
+  for (auto &waveform : waveforms)
+  {
+    for (int op = 0; op < 4; ++op)
+    {
+      FMSynth::Patch patch = patch_organ;
+      patch.op[op].waveform = waveform.waveform;
+      FMSynth::CompiledPatch<8000> compiled = FMSynth::CompiledPatch<8000>::compile(patch);
+      for (int key : waveKeys)
+      {
+        bool blockMatches;
+        QByteArray data = renderNote(patch, compiled, key, 127, false, &blockMatches);
+        Digest digest;
+        digest.name = QString("wave/%1/op%2/%3").arg(waveform.name).arg(op + 1).arg(key);
+        digest.hash = hashBytes((const uint8_t*)data.constData(), data.size());
+        digests += digest;
+        if (!blockMatches)
+        {
+          fprintf(stderr, "FAIL %s: Voice::render from the CompiledPatch differs from Voice::update\n", digest.name.toLocal8Bit().data());
+          ++failures;
+        }
+        if (!waveform.bandlimited)
+          continue;
+        data = renderBandlimited(patch, key, true);
+        digest.name = QString("blep/%1/op%2/%3").arg(waveform.name).arg(op + 1).arg(key);
+        digest.hash = hashBytes((const uint8_t*)data.constData(), data.size());
+        digests += digest;
+        //Otherwise the digest wouldn't cover the PolyBLEP correction at all
+        if (data == renderBandlimited(patch, key, false))
+        {
+          fprintf(stderr, "FAIL %s: the band-limited oscillator plays the same as the naive one\n", digest.name.toLocal8Bit().data());
+          ++failures;
+        }
+      }
+    }
+  }
+  for (auto name : projects)
+  {
+    FMProject project(sourceDir + "/" + name);
+    if (!project.isSaved())
+    {
+      ++failures;
+      continue;
+    }
+    for (int i = 0; i < project.numSongs(); ++i)
+    {
+      FMSong *song = project.getSong(i);
+      bool finished;
+      QByteArray data = renderSong(song, FMSource::VoiceAllocation::SilentFirst, &finished);
+      Digest digest;
+      digest.name = QString("song-silentfirst/%1/%2").arg(name).arg(song->getName());
+      digest.hash = hashBytes((const uint8_t*)data.constData(), data.size());
+      digests += digest;
+      data = renderSong(song, FMSource::VoiceAllocation::FirstFree, &finished);
+      digest.name = QString("song/%1/%2").arg(name).arg(song->getName());
+      digest.hash = hashBytes((const uint8_t*)data.constData(), data.size());
+      digests += digest;
+      //SongRenderer renders until every channel ends so it can only be compared on songs that end
+      if (finished && SongRenderer(1).renderSong(song) != data)
+      {
+        fprintf(stderr, "FAIL %s: SongRenderer differs from FMSource\n", digest.name.toLocal8Bit().data());
+        ++failures;
+      }
+      if (finished && !checkWavExport(song, data, exportDir.filePath("song.wav")))
+      {
+        fprintf(stderr, "FAIL %s: WAV export differs from FMSource\n", digest.name.toLocal8Bit().data());
+        ++failures;
+      }
+    }
+  }
+  if (!checkWavPadding(exportDir.filePath("odd.wav")))
+  {
+    fprintf(stderr, "FAIL wav/padding: an odd data chunk isn't padded to an even length\n");
+    ++failures;
+  }
+  failures += checkDecimator();
+  failures += checkFeatureCache(exportDir.path());
+  failures += checkLikenessBound();
+  failures += checkStealPolicies();
+  int bankMismatches = checkVoiceBank();
+  if (bankMismatches > 0)
+  {
+    fprintf(stderr, "FAIL VoiceBank: %d samples differ from Voice::render\n", bankMismatches);
+    ++failures;
+  }
+  if (update)
+  {
+    if (!saveGolden(goldenLocation, digests))
+    {
+      fprintf(stderr, "Failed to write %s\n", goldenLocation.toLocal8Bit().data());
+      return 1;
+    }
+    printf("Wrote %d digests to %s\n", (int)digests.size(), goldenLocation.toLocal8Bit().data());
+    return (failures > 0) ? 1:0;
+  }
+  if (!loadGolden(goldenLocation, golden))
+  {
+    fprintf(stderr, "Failed to read %s\n", goldenLocation.toLocal8Bit().data());
+    return 1;
+  }
+  for (auto &digest : digests)
+  {
+    bool found = false;
+    for (auto &expected : golden)
+    {
+      if (expected.name != digest.name)
+        continue;
+      found = true;
+      if (expected.hash != digest.hash)
+      {
+        fprintf(stderr, "FAIL %s: %016llx, expected %016llx\n", digest.name.toLocal8Bit().data(), (unsigned long long)digest.hash, (unsigned long long)expected.hash);
+        ++failures;
+      }
+      break;
+    }
+    if (!found)
+    {
+      fprintf(stderr, "FAIL %s: no golden digest\n", digest.name.toLocal8Bit().data());
+      ++failures;
+    }
+  }
+  printf("%d renders checked, %d failures\n", (int)digests.size(), failures);
+  return (failures > 0) ? 1:0;
+}
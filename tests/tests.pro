@@ -0,0 +1,46 @@
+TEMPLATE = app
+TARGET = fmstudio-golden
+
+CONFIG += c++17 console testcase
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS FMSTUDIO_CLI FMSTUDIO_SOURCE_DIR=\\\"$$PWD/..\\\"
+
+LIBS+=-lm
+
+QT = core
+
+CONFIG += release
+
+INCLUDEPATH += ../src ../instruments
+
+SOURCES += \
+        ../src/CHeaderParser/cheaderarray.cpp \
+        ../src/CHeaderParser/cheaderobject.cpp \
+        ../src/CHeaderParser/cheaderparser.cpp \
+        ../src/CHeaderParser/cheadervalue.cpp \
+        ../src/featurecache.cpp \
+        ../src/fmproject.cpp \
+        ../src/fmsong.cpp \
+        ../src/FMSource.cpp \
+        ../src/globals.cpp \
+        ../src/songrenderer.cpp \
+        ../src/undo.cpp \
+        ../src/waveformanalyzer.cpp \
+        ../src/wavwriter.cpp \
+        golden.cpp
+
+HEADERS += \
+        ../src/CHeaderParser/cheaderarray.h \
+        ../src/CHeaderParser/cheaderobject.h \
+        ../src/CHeaderParser/cheaderparser.h \
+        ../src/CHeaderParser/cheadervalue.h \
+        ../src/featurecache.h \
+        ../src/fmproject.h \
+        ../src/fmsong.h \
+        ../src/FMSource.h \
+        ../src/globals.h \
+        ../src/songrenderer.h \
+        ../src/undo.h \
+        ../src/waveformanalyzer.h \
+        ../src/wavwriter.h